@@ -0,0 +1,318 @@
+/*
+ *	benchmarks: the pool allocators against std::allocator, one JSON object per line on stdout
+ *	so the results of two builds can be compared
+ *
+ *		make bench_alloc && ./bench_alloc > results.json
+ *
+ *	every workload runs on volatile/persistent x managed/unmanaged pools with uint8_t, uint16_t and
+ *	uint32_t indices (the number of objects is capped to a quarter of the index range
+ *	to leave room for the pool growth), the persistent pools live in a
+ *	temporary directory.
+ *	libstdc++ node containers (std::set, std::map, std::list) do not accept fancy pointers (see
+ *	test_alloc.33.cpp), the node workloads use a linked list and a binary search tree with ptr links
+ */
+#include "pool_allocator.h"
+#include <chrono>
+#include <random>
+#include <sys/wait.h>
+using namespace std;
+enum{STD,VOLATILE_MANAGED,VOLATILE_UNMANAGED,PERSISTENT_MANAGED,PERSISTENT_UNMANAGED};
+const char* kind_name[]={"std","volatile_managed","volatile_unmanaged","persistent_managed","persistent_unmanaged"};
+template<typename INDEX> const char* index_name(){return sizeof(INDEX)==1 ? "uint8_t" : sizeof(INDEX)==2 ? "uint16_t" : sizeof(INDEX)==4 ? "uint32_t" : "uint64_t";}
+//each configuration has its own payload types, so its own pools and files
+template<int KIND,typename INDEX> struct config;
+template<typename INDEX> struct config<STD,INDEX>{
+	template<typename T> using alloc=std::allocator<T>;
+	enum{MAX=1<<20};
+	static void flush(){}
+};
+#define CONFIG(KIND,ALIAS) \
+template<typename INDEX> struct config<KIND,INDEX>{ \
+	template<typename T> using alloc=ALIAS<T,INDEX>; \
+	enum{MAX=std::numeric_limits<INDEX>::max()/4}; \
+	template<typename T> static void flush(){alloc<T>::flush();} \
+};
+CONFIG(VOLATILE_MANAGED,volatile_allocator_managed)
+CONFIG(VOLATILE_UNMANAGED,volatile_allocator_unmanaged)
+CONFIG(PERSISTENT_MANAGED,persistent_allocator_managed)
+CONFIG(PERSISTENT_UNMANAGED,persistent_allocator_unmanaged)
+//one payload type per workload: every workload starts with a fresh pool
+enum{ALLOC_FREE,CHURN,VECTOR,LIST,TREE,ITERATE,COLD_START};
+template<typename C,int W> struct item{
+	long v;
+	item(long v):v(v){}
+};
+template<typename C,int W> struct node{
+	typedef typename std::allocator_traits<typename C::template alloc<node>>::pointer pointer;
+	long v;
+	pointer left,right;
+	node(long v):v(v),left(nullptr),right(nullptr){}
+};
+//fastest of 3 runs
+template<typename F> double measure(F f){
+	double best=1e9;
+	for(int k=0;k<3;++k){
+		auto start=chrono::steady_clock::now();
+		f();
+		best=min(best,chrono::duration<double>(chrono::steady_clock::now()-start).count());
+	}
+	return best;
+}
+template<int KIND,typename INDEX> void report(const char* benchmark,size_t n,double seconds,size_t failed=0){
+	cout<<"{\"benchmark\":\""<<benchmark<<"\",\"allocator\":\""<<kind_name[KIND]<<"\",\"index\":\""<<index_name<INDEX>()
+		<<"\",\"n\":"<<n<<",\"seconds\":"<<seconds<<",\"ops_per_second\":"<<(seconds>0 ? n/seconds : 0)<<",\"failed\":"<<failed<<"}"<<endl;
+}
+template<int KIND,typename INDEX,typename T,typename... Args> typename std::allocator_traits<typename config<KIND,INDEX>::template alloc<T>>::pointer make(Args... args){
+	typename config<KIND,INDEX>::template alloc<T> a;
+	auto p=a.allocate(1);
+	std::allocator_traits<decltype(a)>::construct(a,&*p,args...);
+	return p;
+}
+template<int KIND,typename INDEX,typename T,typename P> void destroy(P p){
+	typename config<KIND,INDEX>::template alloc<T> a;
+	a.deallocate(p,1);
+}
+template<int KIND,typename INDEX> struct suite{
+	typedef config<KIND,INDEX> C;
+	static size_t cap(size_t n){return std::min<size_t>(n,C::MAX);}
+	template<typename T> static void flush(){
+		if constexpr(KIND!=STD) C::template flush<T>();
+	}
+	//single objects allocated then freed in the same order
+	static void alloc_free(size_t n){
+		typedef item<C,ALLOC_FREE> ITEM;
+		typedef typename C::template alloc<ITEM> ALLOC;
+		typedef typename std::allocator_traits<ALLOC>::pointer pointer;
+		n=cap(n);
+		ALLOC a;
+		vector<pointer> v(n);
+		report<KIND,INDEX>("alloc_free",2*n,measure([&]{
+			for(size_t i=0;i<n;++i) v[i]=a.allocate(1);
+			for(size_t i=0;i<n;++i) a.deallocate(v[i],1);
+		}));
+		flush<ITEM>();
+	}
+	//random sizes, random frees, about half of the objects alive: fragments the free list,
+	//a small index can run out of cells, the failed allocations are counted
+	static void churn(size_t n){
+		typedef item<C,CHURN> ITEM;
+		typedef typename C::template alloc<ITEM> ALLOC;
+		typedef typename std::allocator_traits<ALLOC>::pointer pointer;
+		n=cap(n);
+		ALLOC a;
+		size_t failed=0;
+		double seconds=measure([&]{
+			mt19937 g(42);
+			vector<pair<pointer,size_t>> live;
+			size_t cells=0;
+			for(size_t i=0;i<n;++i){
+				size_t s=1+g()%8;
+				if(cells+s<n/2){
+					try{
+						live.push_back({a.allocate(s),s});
+						cells+=s;
+					}catch(std::bad_alloc&){
+						++failed;
+					}
+				}
+				if(!live.empty()&&(g()%2||cells+8>=n/2)){
+					size_t k=g()%live.size();
+					a.deallocate(live[k].first,live[k].second);
+					cells-=live[k].second;
+					live[k]=live.back();
+					live.pop_back();
+				}
+			}
+			for(auto& l:live) a.deallocate(l.first,l.second);
+		});
+		report<KIND,INDEX>("churn",2*n,seconds,failed/3);
+		flush<ITEM>();
+	}
+	//std::vector growth, every reallocation is a new range
+	static void vector_push(size_t n){
+		typedef item<C,VECTOR> ITEM;
+		typedef typename C::template alloc<ITEM> ALLOC;
+		n=cap(n)/4;
+		report<KIND,INDEX>("vector_push_back",n,measure([&]{
+			vector<ITEM,ALLOC> v;
+			for(size_t i=0;i<n;++i) v.push_back(ITEM(i));
+		}));
+		flush<ITEM>();
+	}
+	//linked list: build then walk
+	static void list(size_t n){
+		typedef node<C,LIST> NODE;
+		n=cap(n);
+		typename NODE::pointer head=nullptr;
+		report<KIND,INDEX>("list_build",n,measure([&]{
+			while(head){
+				auto next=head->right;
+				destroy<KIND,INDEX,NODE>(head);
+				head=next;
+			}
+			for(size_t i=0;i<n;++i){
+				auto p=make<KIND,INDEX,NODE>(i);
+				p->right=head;
+				head=p;
+			}
+		}));
+		long total=0;
+		report<KIND,INDEX>("list_walk",n,measure([&]{
+			for(auto p=head;p;p=p->right) total+=p->v;
+		}));
+		while(head){
+			auto next=head->right;
+			destroy<KIND,INDEX,NODE>(head);
+			head=next;
+		}
+		flush<NODE>();
+		if(total==42) cerr<<total<<endl;
+	}
+	//unbalanced binary search tree with random keys, the access pattern of std::set
+	static void tree(size_t n){
+		typedef node<C,TREE> NODE;
+		n=cap(n);
+		typename NODE::pointer root=nullptr;
+		vector<typename NODE::pointer> all;
+		auto clear=[&]{
+			for(auto p:all) destroy<KIND,INDEX,NODE>(p);
+			all.clear();
+			root=nullptr;
+		};
+		report<KIND,INDEX>("tree_insert",n,measure([&]{
+			clear();
+			mt19937 g(42);
+			for(size_t i=0;i<n;++i){
+				long k=g();
+				auto p=make<KIND,INDEX,NODE>(k);
+				all.push_back(p);
+				if(!root){
+					root=p;
+					continue;
+				}
+				for(auto c=root;;){
+					auto& next=k<c->v ? c->left : c->right;
+					if(!next){
+						next=p;
+						break;
+					}
+					c=next;
+				}
+			}
+		}));
+		size_t found=0;
+		report<KIND,INDEX>("tree_find",n,measure([&]{
+			mt19937 g(42);
+			for(size_t i=0;i<n;++i){
+				long k=g();
+				for(auto c=root;c;c=k<c->v ? c->left : c->right)
+					if(c->v==k){
+						++found;
+						break;
+					}
+			}
+		}));
+		clear();
+		flush<NODE>();
+		if(found==42) cerr<<found<<endl;
+	}
+	//visit every object: through the pointers, then spans and cell_iterator (managed)
+	static void iterate(size_t n){
+		typedef item<C,ITERATE> ITEM;
+		typedef typename C::template alloc<ITEM> ALLOC;
+		typedef typename std::allocator_traits<ALLOC>::pointer pointer;
+		n=cap(n);
+		ALLOC a;
+		vector<pointer> v(n);
+		for(size_t i=0;i<n;++i) v[i]=a.allocate(1);
+		for(size_t i=0;i<n;++i) std::allocator_traits<ALLOC>::construct(a,&*v[i],i);
+		flush<ITEM>();
+		long total=0;
+		report<KIND,INDEX>("iterate_pointers",n,measure([&]{
+			for(auto p:v) total+=p->v;
+		}));
+		if constexpr(KIND!=STD){
+			report<KIND,INDEX>("iterate_spans",n,measure([&]{
+				for(auto& s:ALLOC::spans())
+					for(auto& x:s) total+=x.v;
+			}));
+			if constexpr(ALLOC::CELL::MANAGED)
+				report<KIND,INDEX>("iterate_cells",n,measure([&]{
+					for(auto i=a.cbegin();i!=a.cend();++i) total+=i->v;
+				}));
+		}
+		for(size_t i=0;i<n;++i) a.deallocate(v[i],1);
+		flush<ITEM>();
+		if(total==42) cerr<<total<<endl;
+	}
+	//time to open a populated pool and walk it, in a fresh process
+	static void cold_start(size_t n){
+		typedef item<C,COLD_START> ITEM;
+		typedef typename C::template alloc<ITEM> ALLOC;
+		if constexpr(KIND>=PERSISTENT_MANAGED){
+		n=cap(n);
+		if(pid_t pid=fork()){
+			waitpid(pid,nullptr,0);
+		}else{
+			ALLOC a;
+			for(size_t i=0;i<n;++i) std::allocator_traits<ALLOC>::construct(a,&*a.allocate(1),i);
+			flush<ITEM>();
+			_exit(0);
+		}
+		int fd[2];
+		if(pipe(fd)==-1) return;
+		if(pid_t pid=fork()){
+			close(fd[1]);
+			double seconds=0;
+			if(read(fd[0],&seconds,sizeof(seconds))==sizeof(seconds)) report<KIND,INDEX>("cold_start",n,seconds);
+			close(fd[0]);
+			waitpid(pid,nullptr,0);
+		}else{
+			auto start=chrono::steady_clock::now();
+			long total=0;
+			for(auto& s:ALLOC::spans())
+				for(auto& x:s) total+=x.v;
+			double seconds=chrono::duration<double>(chrono::steady_clock::now()-start).count();
+			if(write(fd[1],&seconds,sizeof(seconds))!=sizeof(seconds)||total==42) _exit(1);
+			_exit(0);
+		}
+		}
+	}
+	//a workload that exhausts a small index is reported as failed
+	template<typename F> static void guard(const char* benchmark,size_t n,F f){
+		try{
+			f(n);
+		}catch(std::bad_alloc&){
+			report<KIND,INDEX>(benchmark,cap(n),0,1);
+		}
+	}
+	static void run(size_t n){
+		guard("cold_start",n,cold_start);
+		guard("alloc_free",n,alloc_free);
+		guard("churn",n,churn);
+		guard("vector_push_back",n,vector_push);
+		guard("list",n,list);
+		guard("tree",n,tree);
+		guard("iterate",n,iterate);
+	}
+};
+template<typename INDEX> void run_index(size_t n){
+	suite<STD,INDEX>::run(n);
+	suite<VOLATILE_MANAGED,INDEX>::run(n);
+	suite<VOLATILE_UNMANAGED,INDEX>::run(n);
+	suite<PERSISTENT_MANAGED,INDEX>::run(n);
+	suite<PERSISTENT_UNMANAGED,INDEX>::run(n);
+}
+int main(int argc,char* argv[]){
+	size_t n=argc>1 ? atol(argv[1]) : 20000;
+	//the persistent pools go in a scratch directory
+	char dir[]="/tmp/bench_alloc.XXXXXX";
+	if(!mkdtemp(dir)||chdir(dir)==-1||mkdir("db",0755)==-1){
+		cerr<<"could not create a scratch directory"<<endl;
+		return 1;
+	}
+	run_index<uint8_t>(n);
+	run_index<uint16_t>(n);
+	run_index<uint32_t>(n);
+	return system((string("rm -rf ")+dir).c_str());
+}
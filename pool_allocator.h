@@ -6,6 +6,10 @@
  */
 #ifndef NO_MMAP
 #endif
+//several processes need the same locking as several threads
+#if defined(POOL_ALLOCATOR_MULTI_PROCESS) && !defined(POOL_ALLOCATOR_THREAD_SAFE)
+#define POOL_ALLOCATOR_THREAD_SAFE
+#endif
 #include <iostream>
 #include <sstream>
 #include <fstream>
@@ -18,19 +22,84 @@
 #include <sys/mman.h>
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/ioctl.h>
+#include <linux/fs.h>
 #include <unistd.h>
 #include <fcntl.h>
 #include <math.h>
 #include <functional>
 #include <algorithm>
 #include <stdexcept>
+#include <exception>
 #include <iomanip>
 #include <cassert>
 #include <experimental/string_view>
-#ifdef POOL_ALLOCATOR_THREAD_SAFE
+#include <tuple>
+#include <memory>
 #include <mutex>
+#include <thread>
+#include <chrono>
+#include <condition_variable>
+#include <atomic>
+#ifdef POOL_ALLOCATOR_MULTI_PROCESS
+#include <pthread.h>
+#include <sys/file.h>
 #endif
 #include "ifthenelse.hpp"
+//upper bound (bytes) of the address space reserved per pool with POOL_ALLOCATOR_STABLE_MMAP
+#if defined(POOL_ALLOCATOR_STABLE_MMAP) && !defined(POOL_ALLOCATOR_MAX_RESERVE)
+#define POOL_ALLOCATOR_MAX_RESERVE (1ULL<<36)
+#endif
+#if defined(POOL_ALLOCATOR_MAGAZINE) && !defined(POOL_ALLOCATOR_MAGAZINE_SIZE)
+#define POOL_ALLOCATOR_MAGAZINE_SIZE 64
+#endif
+//default journal mode of persistent pools: JOURNAL_NONE, JOURNAL_PER_OP or JOURNAL_GROUP
+#ifndef POOL_ALLOCATOR_JOURNAL
+#define POOL_ALLOCATOR_JOURNAL JOURNAL_NONE
+#endif
+//number of operations per group commit
+#ifndef POOL_ALLOCATOR_JOURNAL_GROUP
+#define POOL_ALLOCATOR_JOURNAL_GROUP 64
+#endif
+/*
+ *	POOL_ALLOCATOR_FAST_DEREF: ptr dereference reads a per-type cached buffer address instead of going 
+ *	through get_pool(), ignored with POOL_ALLOCATOR_MULTI_PROCESS (the buffer is per process slot)
+ */
+#if defined(POOL_ALLOCATOR_FAST_DEREF) && defined(POOL_ALLOCATOR_MULTI_PROCESS)
+#undef POOL_ALLOCATOR_FAST_DEREF
+#endif
+/*
+ *	debug output (free list dumps, every allocation, construction...) is compiled out unless 
+ *	POOL_ALLOCATOR_DEBUG is defined, the arguments are not even evaluated, the counters 
+ *	(allocator::get_counters()) follow the activity of a pool in release builds
+ */
+#ifdef POOL_ALLOCATOR_DEBUG
+#define POOL_LOG_DEBUG LOG_DEBUG
+#else
+#define POOL_LOG_DEBUG while(false) std::clog
+#endif
+/*
+ *	POOL_ALLOCATOR_LATENCY: allocator::allocate()/deallocate() are timed into the log2 histograms 
+ *	of pool::counters (two clock reads per call), see allocator::stats()
+ */
+/*
+ *	POOL_ALLOCATOR_DEFAULT_INDEX: index of the aliases (persistent_allocator_managed...) when none is given,
+ *	a pool holds at most 2^(8*sizeof(INDEX))-1 cells.
+ *	POOL_ALLOCATOR_POOL_INDEX: index of the pool of pools, caps the number of pool types (255 with uint8_t).
+ *	The pool of pools is stored in db/<hash> with uint8_t and db/<hash>.<bits> otherwise, so a change 
+ *	starts an empty pool of pools: the pools are registered again and find their files (the size is 
+ *	read from the header of the file), the other pool of pools file is left untouched
+ */
+#ifndef POOL_ALLOCATOR_DEFAULT_INDEX
+#define POOL_ALLOCATOR_DEFAULT_INDEX uint8_t
+#endif
+#ifndef POOL_ALLOCATOR_POOL_INDEX
+#define POOL_ALLOCATOR_POOL_INDEX uint8_t
+#endif
+//default percentage of free cells above which deallocate() trims the pool, 0 to disable
+#ifndef POOL_ALLOCATOR_TRIM_THRESHOLD
+#define POOL_ALLOCATOR_TRIM_THRESHOLD 0
+#endif
 namespace pool_allocator{
 	extern int verbosity;
 	extern const char _context_[];
@@ -91,22 +160,28 @@ namespace pool_allocator{
 		enum{MANAGED=true};
 		enum{OPTIMIZATION=false};
 		enum{FACTOR=1};
+		enum{SPLIT=false};
+		//cells needed for n payloads, at least one
+		static constexpr size_t cells_for(size_t n){return n>1 ? n : 1;}
 		static const size_t MAX_SIZE=std::numeric_limits<INDEX>::max();
 		static const size_t MAX_BUFFER_SIZE=MAX_SIZE;//+1;//what if MAX_SIZE+1=0 that is INDEX=size_t
 		static const INDEX max_index=std::numeric_limits<INDEX>::max();//max_index and MAX_SIZE are the same because cell 0 is off-limit
-		static void post_allocate(cell* begin,cell* end){
-			for(cell* i=begin;i<end;++i) i->management=0x1;//will increase for reference counting	
+		//cells [i,i+n) of buffer c
+		static void post_allocate(cell* c,size_t i,size_t n){
+			for(cell* j=c+i;j<c+i+n;++j) j->management=0x1;//will increase for reference counting	
 		}
-		static void post_deallocate(cell* begin,cell* end){
-			for(cell* i=begin;i<end;++i) i->management=0x0;	
+		static void post_deallocate(cell* c,size_t i,size_t n){
+			for(cell* j=c+i;j<c+i+n;++j) j->management=0x0;	
 		}
-		static void is_available(cell* begin,cell* end){
-			for(cell* i=begin;i<end;++i) 
-				if(i->management) throw std::out_of_range("already allocated");	
+		static void is_available(cell* c,size_t i,size_t n){
+			for(cell* j=c+i;j<c+i+n;++j) 
+				if(j->management) throw std::out_of_range("already allocated");	
 		}
+		//false if cell i is known to be free
+		static bool in_use(const cell* c,size_t i){return c[i].management;}
 		//check if the cell has been allocated
-		static void check(const cell& c,INDEX index){
-			if(!c.management) throw std::out_of_range(std::string("bad reference ")+std::to_string(index)+" "+typeid(PAYLOAD).name());	
+		static void check(const cell* c,INDEX index){
+			if(!c[index].management) throw std::out_of_range(std::string("bad reference ")+std::to_string(index)+" "+typeid(PAYLOAD).name());	
 		}
 		#ifdef REF_COUNT
 		static void increase_ref_count(cell& c){++c.management;}
@@ -138,14 +213,320 @@ namespace pool_allocator{
 		enum{OPTIMIZATION=(sizeof(INFO)>sizeof(PAYLOAD))&&(sizeof(INFO)%sizeof(PAYLOAD)==0)};
 		//enum{OPTIMIZATION=false};
 		enum{FACTOR=OPTIMIZATION ? sizeof(INFO)/sizeof(PAYLOAD) : 1};
+		enum{SPLIT=false};
+		//cells needed for n payloads, at least one, FACTOR is a power of 2 known at compile time: the division is a shift
+		static constexpr size_t cells_for(size_t n){return n>FACTOR ? (n+FACTOR-1)/FACTOR : 1;}
 		static const size_t MAX_BUFFER_SIZE=(1ULL<<(sizeof(INDEX)<<3))/FACTOR;
 		static const size_t MAX_SIZE=std::numeric_limits<INDEX>::max()/FACTOR-1;
 		static const INDEX max_index=std::numeric_limits<INDEX>::max()/FACTOR;
-		static void post_allocate(cell*,cell*){}
-		static void post_deallocate(cell*,cell*){}
-		static void is_available(cell* begin,cell* end){}
-		static void check(const cell& c,INDEX){}
+		static void post_allocate(cell*,size_t,size_t){}
+		static void post_deallocate(cell*,size_t,size_t){}
+		static void is_available(cell*,size_t,size_t){}
+		static bool in_use(const cell*,size_t){return true;}
+		static void check(const cell*,INDEX){}
+		#ifdef REF_COUNT
+		static void increase_ref_count(cell& c){}
+		static void decrease_ref_count(cell& c){}
+		static int get_ref_count(cell& c){return 0;}
+		#endif
+	};
+	/*
+	 *	free list policy, can be selected per payload:
+	 *
+	 *		template<> struct pool_allocator::segregated_fit<my_type>{enum{value=true};};
+	 *
+	 *	first fit (default) walks the free list until a big enough range is found, the cost grows
+	 *	with fragmentation.
+	 *	segregated fit bins the free ranges by size class (power of 2): de-allocation is O(1) and 
+	 *	allocation too when a class above the request's is not empty, otherwise the ranges of the 
+	 *	request's class are scanned. De-allocation does not merge the neighbours, the adjacent free 
+	 *	ranges are merged in one pass when no range is big enough, before the pool grows.
+	 *	The ranges are still chained from cell 0 (bins are consecutive segments of the list, 
+	 *	smallest class first) so the buffer stays readable by a first fit pool.
+	 *	Define SEGREGATED_FIT to make it the default.
+	 */
+	template<typename PAYLOAD> struct segregated_fit{
+		//the bins are process-local, they would go stale if another process used the pool
+		#if defined(SEGREGATED_FIT) && !defined(POOL_ALLOCATOR_MULTI_PROCESS)
+		enum{value=true};
+		#else
+		enum{value=false};
+		#endif
+	};
+	/*
+	 *	growth policies: number of cells to add to a pool of `current' cells that needs `needed' more,
+	 *	the result is capped at CELL::MAX_BUFFER_SIZE.
+	 *	Growing by the exact amount makes appending quadratic (copy of the buffer or file extension every time)
+	 */ 
+	struct exact_growth{
+		static size_t get(size_t /*current*/,size_t needed){return needed;}
+	};
+	template<size_t NUM=2,size_t DEN=1> struct geometric_growth{
+		static size_t get(size_t current,size_t needed){return std::max<size_t>(current*NUM/DEN-current,needed);}
+	};
+	template<size_t CHUNK> struct chunk_growth{
+		static size_t get(size_t /*current*/,size_t needed){return (needed+CHUNK-1)/CHUNK*CHUNK;}
+	};
+	/*
+	 *	can be selected per payload:
+	 *
+	 *		template<> struct pool_allocator::growth_policy<my_type>:pool_allocator::chunk_growth<1024>{};
+	 *
+	 *	the pool doubles by default, define POOL_ALLOCATOR_EXACT_GROWTH for the former behaviour
+	 */
+	#ifdef POOL_ALLOCATOR_EXACT_GROWTH
+	template<typename PAYLOAD> struct growth_policy:exact_growth{};
+	#else
+	template<typename PAYLOAD> struct growth_policy:geometric_growth<>{};
+	#endif
+	/*
+	 *	automatic trim: percentage of free cells above which the free range at the end of the pool 
+	 *	is given back after a de-allocation, can be selected per payload:
+	 *
+	 *		template<> struct pool_allocator::trim_threshold<my_type>{enum{value=50};};
+	 *
+	 *	0 (default) means trim() is only called explicitly
+	 */
+	template<typename PAYLOAD> struct trim_threshold{
+		enum{value=POOL_ALLOCATOR_TRIM_THRESHOLD};
+	};
+	/*
+	 *	side bitmap of the allocated cells of a managed pool, iterators skip free regions 64 cells
+	 *	at a time instead of probing the management of each cell, can be selected per payload:
+	 *
+	 *		template<> struct pool_allocator::occupancy_index<my_type>{enum{value=true};};
+	 *
+	 *	off by default, define POOL_ALLOCATOR_OCCUPANCY to turn it on for all payloads.
+	 *	The bitmap is process-local so it is ignored with POOL_ALLOCATOR_MULTI_PROCESS
+	 */
+	template<typename PAYLOAD> struct occupancy_index{
+		#ifdef POOL_ALLOCATOR_OCCUPANCY
+		enum{value=true};
+		#else
+		enum{value=false};
+		#endif
+	};
+	/*
+	 *	crash consistency of persistent pools, can be selected per payload:
+	 *
+	 *		template<> struct pool_allocator::journal_mode<my_type>{enum{value=pool_allocator::JOURNAL_PER_OP};};
+	 *
+	 *	JOURNAL_NONE: no journal, an interrupted allocate/deallocate can leave the free list corrupt
+	 *	JOURNAL_PER_OP: every record is synced before the cell is modified and the pages named by the 
+	 *	records are synced after each operation, survives process and system crashes
+	 *	JOURNAL_GROUP: the pages named by the records are synced every POOL_ALLOCATOR_JOURNAL_GROUP 
+	 *	operations but the records themselves are not: a process crash rolls back to the last group,
+	 *	a system crash is not covered (the kernel can write a pool page back before its record)
+	 */
+	enum{JOURNAL_NONE,JOURNAL_PER_OP,JOURNAL_GROUP};
+	template<typename PAYLOAD> struct journal_mode{
+		enum{value=POOL_ALLOCATOR_JOURNAL};
+	};
+	/*
+	 *	what the pool needs to know about the raw allocator:
+	 *	VOLATILE: the buffer does not survive the process
+	 *	IN_PLACE: allocate(n) resizes the current buffer (content is kept and new bytes are zeroed),
+	 *	otherwise it returns a new buffer and the pool has to copy and free the old one
+	 */
+	template<typename RAW_ALLOCATOR> struct raw_allocator_traits{
+		enum{VOLATILE=false};
+		enum{IN_PLACE=true};
+		//upper bound of the buffer size, called before the first allocation
+		static void reserve(size_t){}
+		//backing file, the journal lives next to it
+		static std::string file_name(){return std::string();}
+		//current size of the backing file, might have been changed by another process
+		static size_t file_size(){return 0;}
+		//false if the backing file could only be opened read-only
+		static bool writable(const RAW_ALLOCATOR&){return true;}
+		//IN_PLACE only: give back the memory (and file) beyond n bytes, false if it was kept
+		static bool truncate(size_t){return false;}
+	};
+	template<> struct raw_allocator_traits<std::allocator<char>>{
+		enum{VOLATILE=true};
+		enum{IN_PLACE=false};
+		static void reserve(size_t){}
+		static std::string file_name(){return std::string();}
+		static size_t file_size(){return 0;}
+		static bool writable(const std::allocator<char>&){return true;}
+		static bool truncate(size_t){return false;}
+	};
+	/*
+	*	contiguous buffer kept next to a pool (columns, management of split cells), it comes from the 
+	*	pool's raw allocator rebound to its owner so it is persistent if the pool is. It only grows and 
+	*	the new bytes are zeroed, the size is atomic and published after the buffer: it can be tested 
+	*	without the lock
+	*/ 
+	template<typename RAW_ALLOCATOR> struct side_buffer{
+		std::atomic<char*> buffer{nullptr};
+		std::atomic<size_t> buffer_size{0};
+		RAW_ALLOCATOR raw;
+		#ifdef POOL_ALLOCATOR_THREAD_SAFE
+		std::mutex m;
+		#endif
+		//at least n bytes, get_size(n) gives the new size
+		template<typename F> char* reserve(size_t n,F get_size){
+			if(n>buffer_size.load(std::memory_order_acquire)){
+				#ifdef POOL_ALLOCATOR_THREAD_SAFE
+				std::lock_guard<std::mutex> l(m);
+				#endif
+				size_t old_size=buffer_size.load(std::memory_order_relaxed);
+				if(n>old_size){
+					size_t new_size=get_size(n);
+					char* old_buffer=buffer.load(std::memory_order_relaxed);
+					char* new_buffer=raw.allocate(new_size);
+					if(!raw_allocator_traits<RAW_ALLOCATOR>::IN_PLACE){
+						if(old_buffer) memcpy(new_buffer,old_buffer,old_size);
+						memset(new_buffer+old_size,0,new_size-old_size);
+						if(old_buffer) raw.deallocate(old_buffer,old_size);
+					}
+					buffer.store(new_buffer,std::memory_order_release);
+					buffer_size.store(new_size,std::memory_order_release);
+				}
+			}
+			return buffer.load(std::memory_order_acquire);
+		}
+		void checkpoint(bool sync){
+			char* b=buffer.load(std::memory_order_acquire);
+			if(raw_allocator_traits<RAW_ALLOCATOR>::VOLATILE||!b) return;
+			if(msync(b,buffer_size.load(std::memory_order_acquire),sync ? MS_SYNC : MS_ASYNC)==-1) LOG_ERROR<<"msync failed: "<<strerror(errno)<<std::endl;
+		}
+		//synchronous write of the pages holding bytes [offset,offset+n)
+		void sync(size_t offset,size_t n){
+			enum{PAGE_SIZE=4096};
+			char* b=buffer.load(std::memory_order_acquire);
+			size_t size=buffer_size.load(std::memory_order_acquire);
+			if(raw_allocator_traits<RAW_ALLOCATOR>::VOLATILE||!b||offset>=size) return;
+			size_t begin=offset/PAGE_SIZE*PAGE_SIZE;
+			if(msync(b+begin,std::min(offset+n,size)-begin,MS_SYNC)==-1) LOG_ERROR<<"msync failed: "<<strerror(errno)<<std::endl;
+		}
+	};
+	/*
+	*	structure of arrays layout of a managed pool, can be selected per payload:
+	*
+	*		template<> struct pool_allocator::soa<my_type>{enum{value=true};};
+	*
+	*	the management of cell i is entry i of a side buffer instead of a member of the cell, a cell is 
+	*	then only the union of the payload and the free list info: no padding after a bool management
+	*	and scans of the payload or of the management read dense memory. ptr is unchanged (index).
+	*	The managed allocators pick the layout from the payload (see management_layout), the pool has
+	*	its own file (suffix .soa) so a file written with the other layout is never read.
+	*	Not supported: the generic iterator (pool not iterable), snapshot(), migrate_index(), REF_COUNT
+	*/ 
+	template<typename PAYLOAD> struct soa{
+		enum{value=false};
+	};
+	//management tag of the split cells
+	template<typename M> struct split{
+		typedef M type;
+	};
+	template<typename PAYLOAD,typename MANAGEMENT> struct management_layout{
+		typedef typename std::conditional<soa<PAYLOAD>::value,split<MANAGEMENT>,MANAGEMENT>::type type;
+	};
+	template<typename PAYLOAD,typename M> struct management_layout<PAYLOAD,split<M>>:management_layout<PAYLOAD,M>{};
+	template<typename PAYLOAD> struct management_layout<PAYLOAD,void>{
+		typedef void type;
+	};
+	template<
+		typename _PAYLOAD_,
+		typename _INDEX_,
+		typename _ALLOCATOR_,
+		typename _RAW_ALLOCATOR_,
+		typename _M_,
+		typename _INFO_
+	> struct cell<_PAYLOAD_,_INDEX_,_ALLOCATOR_,_RAW_ALLOCATOR_,split<_M_>,_INFO_>{
+		typedef _PAYLOAD_ PAYLOAD;
+		typedef _INDEX_ INDEX;
+		typedef _ALLOCATOR_ ALLOCATOR;
+		typedef _RAW_ALLOCATOR_ RAW_ALLOCATOR;
+		typedef split<_M_> MANAGEMENT;
+		typedef _M_ M;
+		typedef _INFO_ INFO;
+		cell(const cell&)=delete;
+		union{
+			INFO info;
+			PAYLOAD payload;
+		}body;
+		typedef cell<PAYLOAD,INDEX,ALLOCATOR,RAW_ALLOCATOR,MANAGEMENT,_info<void>> HELPER;	
+		enum{MANAGED=true};
+		enum{OPTIMIZATION=false};
+		enum{FACTOR=1};
+		enum{SPLIT=true};
+		static constexpr size_t cells_for(size_t n){return n>1 ? n : 1;}
+		static const size_t MAX_SIZE=std::numeric_limits<INDEX>::max();
+		static const size_t MAX_BUFFER_SIZE=MAX_SIZE;
+		static const INDEX max_index=std::numeric_limits<INDEX>::max();
+		//the management has its own file: the raw allocator rebound to the cell
+		typedef typename IfThenElse<
+			std::is_same<RAW_ALLOCATOR,std::allocator<char>>::value,
+			RAW_ALLOCATOR,
+			typename RAW_ALLOCATOR::template rebind<cell>::other
+		>::ResultT MANAGEMENT_ALLOCATOR;
+		typedef raw_allocator_traits<MANAGEMENT_ALLOCATOR> TRAITS;
+		static side_buffer<MANAGEMENT_ALLOCATOR>& get_management(){
+			static side_buffer<MANAGEMENT_ALLOCATOR> b;
+			static bool loaded=load(b);
+			(void)loaded;
+			return b;
+		}
+		//entries already in the file
+		static bool load(side_buffer<MANAGEMENT_ALLOCATOR>& b){
+			size_t n=TRAITS::file_size()/sizeof(M)*sizeof(M);
+			if(n) b.reserve(n,[](size_t n){return n;});
+			return true;
+		}
+		//room for the management of n cells, the pool calls it when it grows
+		static M* reserve(size_t n){
+			auto& b=get_management();
+			return (M*)b.reserve(n*sizeof(M),[&b](size_t n){
+				return std::max(std::max(n,2*b.buffer_size.load(std::memory_order_relaxed)),TRAITS::file_size()/sizeof(M)*sizeof(M));
+			});
+		}
+		//a cell past the end of the buffer is free
+		static M get(size_t i){
+			auto& b=get_management();
+			if((i+1)*sizeof(M)>b.buffer_size.load(std::memory_order_acquire)){
+				#ifdef POOL_ALLOCATOR_MULTI_PROCESS
+				//another process might have grown the file
+				if((i+1)*sizeof(M)>TRAITS::file_size()) return 0;
+				reserve(i+1);
+				#else
+				return 0;
+				#endif
+			}
+			return ((const M*)b.buffer.load(std::memory_order_acquire))[i];
+		}
+		static void post_allocate(cell*,size_t i,size_t n){
+			M* m=reserve(i+n);
+			for(size_t j=i;j<i+n;++j) m[j]=0x1;
+		}
+		static void post_deallocate(cell*,size_t i,size_t n){
+			M* m=reserve(i+n);
+			for(size_t j=i;j<i+n;++j) m[j]=0x0;
+		}
+		static void is_available(cell*,size_t i,size_t n){
+			for(size_t j=i;j<i+n;++j)
+				if(get(j)) throw std::out_of_range("already allocated");	
+		}
+		static bool in_use(const cell*,size_t i){return get(i);}
+		static void check(const cell*,INDEX index){
+			if(!get(index)) throw std::out_of_range(std::string("bad reference ")+std::to_string(index)+" "+typeid(PAYLOAD).name());	
+		}
+		//compaction moved cell i to j
+		static void move(size_t i,size_t j){
+			M* m=reserve(std::max(i,j)+1);
+			m[j]=m[i];
+		}
+		//new pool
+		static void reset(){
+			auto& b=get_management();
+			if(char* p=b.buffer.load(std::memory_order_acquire)) memset(p,0,b.buffer_size.load(std::memory_order_acquire));
+		}
+		static void checkpoint(bool sync){get_management().checkpoint(sync);}
+		//management of cells [i,i+n)
+		static void sync(size_t i,size_t n){get_management().sync(i*sizeof(M),n*sizeof(M));}
 		#ifdef REF_COUNT
+		//reference counting needs the management in the cell
 		static void increase_ref_count(cell& c){}
 		static void decrease_ref_count(cell& c){}
 		static int get_ref_count(cell& c){return 0;}
@@ -166,6 +547,26 @@ namespace pool_allocator{
 			typename _RAW_ALLOCATOR_,
 			typename _MANAGEMENT_
 		> struct ptr_d;
+		//returned by allocator::snapshot()
+		template<typename CELL> struct snapshot;
+		template<typename T> struct strided_span;
+		struct counters;
+		struct stats;
+		/*
+		*	what a ptr dereferences to: with POOL_ALLOCATOR_READ_ONLY the persistent payloads are mapped
+		*	PROT_READ so writing through a ptr is a compile error rather than a fault, the volatile pools 
+		*	and the pool of pools (private mapping) stay writable
+		*/ 
+		template<typename T,typename RAW_ALLOCATOR> struct target{
+			#ifdef POOL_ALLOCATOR_READ_ONLY
+			typedef typename std::conditional<raw_allocator_traits<RAW_ALLOCATOR>::VOLATILE,T,const T>::type type;
+			#else
+			typedef T type;
+			#endif
+		};
+		template<typename RAW_ALLOCATOR> struct target<pool,RAW_ALLOCATOR>{
+			typedef pool type;
+		};
 		template<
 			typename VALUE_TYPE,//not consistent
 			typename INDEX,
@@ -180,6 +581,7 @@ namespace pool_allocator{
 			typedef VALUE_TYPE value_type;
 			typedef value_type element_type;
 			typedef VALUE_TYPE& reference;
+			typedef typename target<VALUE_TYPE,RAW_ALLOCATOR>::type target_type;
 			typedef ptrdiff_t difference_type;
 			typedef std::random_access_iterator_tag iterator_category;
 			ptr(std::nullptr_t=nullptr):index(0){}
@@ -188,21 +590,21 @@ namespace pool_allocator{
 			#ifdef REF_COUNT
 			ptr(const ptr& p):index(p.index){
 				if(is_same<MANAGEMENT,uint8_t>::value){	
-					LOG_DEBUG<<"copy constructor"<<std::endl;	
+					POOL_LOG_DEBUG<<"copy constructor"<<std::endl;	
 					//LOG<<"management:"<<(int)pool::get_pool<CELL>()->get_cell_cast<CELL>(index).management<<endl;
-					LOG_DEBUG<<"management:"<<CELL::get_ref_count(pool::get_pool<CELL>()->get_cell_cast<CELL>(index))<<std::endl;
+					POOL_LOG_DEBUG<<"management:"<<CELL::get_ref_count(pool::get_pool<CELL>()->get_cell_cast<CELL>(index))<<std::endl;
 					CELL::increase_ref_count(pool::get_pool<CELL>()->get_cell_cast<CELL>(index)); 
 				}
 			}
 			ptr& operator=(const ptr& p){
 				if(is_same<MANAGEMENT,uint8_t>::value){	
-					LOG_DEBUG<<"copy operator"<<std::endl;	
+					POOL_LOG_DEBUG<<"copy operator"<<std::endl;	
 					if(index){
 						//if(pool::get_pool<CELL>()->get_cell_cast<CELL>(index).management==1){
 						if(CELL::get_ref_count(pool::get_pool<CELL>()->get_cell_cast<CELL>(index))==1){
 							(*this)->~VALUE_TYPE();
 							allocator<VALUE_TYPE,INDEX,ALLOCATOR,RAW_ALLOCATOR,MANAGEMENT> a;
-							pool::get_pool<CELL>()->template deallocate<CELL>(index/CELL::FACTOR,std::max<size_t>(1/CELL::FACTOR,1));
+							pool::get_pool<CELL>()->template deallocate<CELL>(index/CELL::FACTOR,CELL::cells_for(1));
 							//a.deallocate(*this,1);//makes a copy
 						}else{
 							//--pool::get_pool<CELL>()->get_cell_cast<CELL>(index).management;
@@ -220,15 +622,15 @@ namespace pool_allocator{
 			
 			~ptr(){
 				if(is_same<MANAGEMENT,uint8_t>::value){	
-					LOG_DEBUG<<"~ptr"<<std::endl;
+					POOL_LOG_DEBUG<<"~ptr"<<std::endl;
 					//LOG<<"management:"<<(int)pool::get_pool<CELL>()->get_cell_cast<CELL>(index).management<<endl;
-					LOG_DEBUG<<"management:"<<CELL::get_ref_count(pool::get_pool<CELL>()->get_cell_cast<CELL>(index))<<endl;
+					POOL_LOG_DEBUG<<"management:"<<CELL::get_ref_count(pool::get_pool<CELL>()->get_cell_cast<CELL>(index))<<endl;
 					if(index){
 						//if(pool::get_pool<CELL>()->get_cell_cast<CELL>(index).management==1){
 						if(CELL::get_ref_count(pool::get_pool<CELL>()->get_cell_cast<CELL>(index))==1){
 							(*this)->~VALUE_TYPE();
 							allocator<VALUE_TYPE,INDEX,ALLOCATOR,RAW_ALLOCATOR,MANAGEMENT> a;
-							pool::get_pool<CELL>()->template deallocate<CELL>(index/CELL::FACTOR,std::max<size_t>(1/CELL::FACTOR,1));
+							pool::get_pool<CELL>()->template deallocate<CELL>(index/CELL::FACTOR,CELL::cells_for(1));
 							//a.deallocate(*this,1);//makes a copy
 						}else{
 							//--pool::get_pool<CELL>()->get_cell_cast<CELL>(index).management;
@@ -274,14 +676,22 @@ namespace pool_allocator{
 			}
 			*/
 			//static ptr pointer_to(element_type&){}
-			value_type* operator->()const{
+			target_type* operator->()const{
 				typedef typename IfThenElse<CELL::OPTIMIZATION,typename CELL::HELPER,CELL>::ResultT PAYLOAD_CELL;
+				#ifdef POOL_ALLOCATOR_FAST_DEREF
+				return &pool::get_payload_fast<CELL,PAYLOAD_CELL>(index);
+				#else
 				return &pool::get_pool<CELL>()->template get_payload<PAYLOAD_CELL>(index);
+				#endif
 			}
-			reference operator*()const{
+			target_type& operator*()const{
 				if(!index) throw std::runtime_error(std::string("null reference for ")+typeid(VALUE_TYPE).name());	
 				typedef typename IfThenElse<CELL::OPTIMIZATION,typename CELL::HELPER,CELL>::ResultT PAYLOAD_CELL;
+				#ifdef POOL_ALLOCATOR_FAST_DEREF
+				return pool::get_payload_fast<CELL,PAYLOAD_CELL>(index);
+				#else
 				return pool::get_pool<CELL>()->template get_payload<PAYLOAD_CELL>(index);
+				#endif
 			}
 			ptr& operator+=(INDEX s){index+=s;return *this;}
 			ptr& operator++(){++index;return *this;}
@@ -303,10 +713,10 @@ namespace pool_allocator{
 			//make cast operators explicit otherwise ambiguous calls to operator== and +
 			explicit operator bool() const{return index;}
 			#ifdef FIX_AMBIGUITY
-			explicit operator value_type*(){return index ? operator->():0;}
+			explicit operator target_type*(){return index ? operator->():0;}
 			explicit operator const value_type*() const{return index ? operator->():0;}
 			#else
-			operator value_type*(){return index ? operator->():0;}
+			operator target_type*(){return index ? operator->():0;}
 			operator const value_type*() const{return index ? operator->():0;}
 			#endif
 			void _print(std::ostream& os)const{}
@@ -349,12 +759,20 @@ namespace pool_allocator{
 			> ptr(const ptr_d<_OTHER_PAYLOAD_,_OTHER_INDEX_,_OTHER_ALLOCATOR_,_OTHER_RAW_ALLOCATOR_,_OTHER_MANAGEMENT_>& p);
 			value_type* operator->()const{
 				typedef typename IfThenElse<CELL::OPTIMIZATION,typename CELL::HELPER,CELL>::ResultT PAYLOAD_CELL;
+				#ifdef POOL_ALLOCATOR_FAST_DEREF
+				return &pool::get_payload_fast<CELL,PAYLOAD_CELL>(index);
+				#else
 				//should use different call because it return a pointer to const, get_const_payload?
 				return &pool::get_pool<CELL>()->template get_payload<PAYLOAD_CELL>(index);
+				#endif
 			}
 			reference operator*()const{
 				typedef typename IfThenElse<CELL::OPTIMIZATION,typename CELL::HELPER,CELL>::ResultT PAYLOAD_CELL;
+				#ifdef POOL_ALLOCATOR_FAST_DEREF
+				return pool::get_payload_fast<CELL,PAYLOAD_CELL>(index);
+				#else
 				return pool::get_pool<CELL>()->template get_payload<PAYLOAD_CELL>(index);
+				#endif
 			}
 			ptr& operator+=(INDEX s){index+=s;return *this;}
 			ptr& operator++(){++index;return *this;}
@@ -387,32 +805,36 @@ namespace pool_allocator{
 			typename INDEX,
 			typename ALLOCATOR,//not needed
 			typename RAW_ALLOCATOR,//not needed
-			typename MANAGEMENT
+			typename MANAGEMENT,
+			bool CONST=false	/* const_iterator, the only kind of iterator on a read-only pool */
 		>class cell_iterator{
 			friend struct pool;
 			INDEX index;
 			INDEX cell_index;
 		public:
 			typedef cell<PAYLOAD,INDEX,ALLOCATOR,RAW_ALLOCATOR,MANAGEMENT> CELL;
+		private:
+			void skip(){
+				auto p=pool::get_pool<CELL>();
+				if(index<p->template get_cells<CELL>()[0].body.info.size)
+					cell_index=pool::next_allocated<CELL>(p->template get_cells<CELL>(),cell_index,p->size());
+			}
+		public:
 			typedef cell_iterator pointer;
 			typedef PAYLOAD value_type;
-			typedef PAYLOAD& reference;
+			typedef typename IfThenElse<CONST,const PAYLOAD&,PAYLOAD&>::ResultT reference;
 			typedef ptrdiff_t difference_type;
 			typedef std::forward_iterator_tag iterator_category;
 			cell_iterator(INDEX index=0):index(index),cell_index(1){
-				if(index<pool::get_pool<CELL>()->template get_cells<CELL>()[0].body.info.size){
-					while(!pool::get_pool<CELL>()->template get_cells<CELL>()[cell_index].management) ++cell_index;
-				}
+				skip();
 			}
 			cell_iterator& operator++(){
 				++index;
 				++cell_index;//otherwise always stays on same cell
-				if(index<pool::get_pool<CELL>()->template get_cells<CELL>()[0].body.info.size){
-					while(!pool::get_pool<CELL>()->template get_cells<CELL>()[cell_index].management) ++cell_index;
-				}
+				skip();
 				return *this;
 			}
-			value_type* operator->() const{return &pool::get_pool<CELL>()->template get_cells<CELL>()[cell_index].body.payload;}	
+			typename std::remove_reference<reference>::type* operator->() const{return &pool::get_pool<CELL>()->template get_cells<CELL>()[cell_index].body.payload;}	
 			reference operator*() const{return pool::get_pool<CELL>()->template get_cells<CELL>()[cell_index].body.payload;}
 			bool operator==(const cell_iterator& a)const{return index==a.index;}
 			bool operator<(const cell_iterator& a)const{return index<a.index;}
@@ -429,10 +851,25 @@ namespace pool_allocator{
 			bool writable;
 			void* v;
 			size_t file_size;
+			/*
+			*	with POOL_ALLOCATOR_STABLE_MMAP the whole range the pool can ever use is reserved (PROT_NONE) 
+			*	up front and the file is mapped at its beginning, growing the file is then a ftruncate and 
+			*	a mmap(MAP_FIXED) of the new pages: the buffer never moves and raw pointers stay valid
+			*/ 
+			size_t reserved;
 			enum{PAGE_SIZE=4096};
-			mmap_allocator_impl(std::string filename):writable(true){
+			/*
+			*	read-only files (or POOL_ALLOCATOR_READ_ONLY) are mapped PROT_READ and shared with the page cache,
+			*	except the pool of pools (private_copy) that is mapped MAP_PRIVATE: this process can still 
+			*	update its pool structs, only the pages written to are copied
+			*/ 
+			mmap_allocator_impl(std::string filename,[[maybe_unused]] size_t reserved=0,bool private_copy=false):writable(true),reserved(0){
+				#ifdef POOL_ALLOCATOR_READ_ONLY
+				fd=-1;
+				#else
 				LOG_NOTICE<<"opening file `"<<filename<<"' O_RDWR"<<std::endl;
 				fd = open(filename.c_str(), O_RDWR | O_CREAT/* | O_TRUNC*/, (mode_t)0600);
+				#endif
 				if(fd ==-1){
 					LOG_NOTICE<<"opening file `"<<filename<<"' O_RDONLY"<<std::endl;
 					fd = open(filename.c_str(), O_RDONLY/* | O_TRUNC*/, (mode_t)0600);
@@ -468,30 +905,79 @@ namespace pool_allocator{
 				}else{
 					file_size=s.st_size;
 				}
-				v = writable ? mmap((void*)NULL,file_size,PROT_READ|PROT_WRITE,MAP_SHARED,fd,0) : mmap((void*)NULL,file_size,PROT_READ,MAP_SHARED,fd,0);
-				LOG_NOTICE<<"new mapping at "<<v<<" size:"<<file_size<<std::endl;
+				int prot=writable||private_copy ? PROT_READ|PROT_WRITE : PROT_READ;
+				int flags=writable||!private_copy ? MAP_SHARED : MAP_PRIVATE;
+				#ifdef POOL_ALLOCATOR_STABLE_MMAP
+				if(reserved){
+					reserved=std::max<size_t>((reserved+PAGE_SIZE-1)/PAGE_SIZE*PAGE_SIZE,file_size);
+					void* base=mmap((void*)NULL,reserved,PROT_NONE,MAP_PRIVATE|MAP_ANONYMOUS|MAP_NORESERVE,-1,0);
+					if(base==MAP_FAILED){
+						LOG_WARNING<<"could not reserve "<<reserved<<" bytes, the mapping will move"<<std::endl;
+					}else{
+						this->reserved=reserved;
+						v=mmap(base,file_size,prot,flags|MAP_FIXED,fd,0);
+					}
+				}
+				if(!this->reserved)
+				#endif
+				v = mmap((void*)NULL,file_size,prot,flags,fd,0);
+				LOG_NOTICE<<"new mapping at "<<v<<" size:"<<file_size<<" reserved:"<<this->reserved<<std::endl;
 				if (v == MAP_FAILED) {
 					close(fd);
 					LOG_ERROR<<"Error mmapping the file"<<std::endl;
 					exit(EXIT_FAILURE);
 				}
 			}
+			//current size of the file
+			size_t get_size() const{
+				struct stat s;
+				return fstat(fd,&s)==-1 ? 0 : s.st_size;
+			}
 			//it is not a proper allocator, can we make it a proper allocator so we can easily swap?
 			char* allocate(size_t n){
-				LOG_DEBUG<<"mmap_allocator::allocate()"<<std::endl;
-				if(n>file_size){
-					size_t _file_size=std::max<size_t>(ceil((double)(n)/PAGE_SIZE),1)*PAGE_SIZE;
-					int result = lseek(fd,_file_size-1, SEEK_SET);
-					if (result == -1) {
-						close(fd);
-						LOG_ERROR<<"Error calling lseek() to 'stretch' the file"<<std::endl;
-						exit(EXIT_FAILURE);
+				POOL_LOG_DEBUG<<"mmap_allocator::allocate()"<<std::endl;
+				if(!writable){
+					if(n>file_size) LOG_WARNING<<"read-only file smaller than requested: "<<file_size<<" < "<<n<<std::endl;
+					return (char*)v;
+				}
+				#ifdef POOL_ALLOCATOR_STABLE_MMAP
+				if(n>file_size && reserved){
+					size_t _file_size=std::max<size_t>((n+PAGE_SIZE-1)/PAGE_SIZE,1)*PAGE_SIZE;
+					if(_file_size>reserved){
+						LOG_ERROR<<"reserved address space exhausted"<<std::endl;
+						throw std::bad_alloc();
 					}
-					result = write(fd, "", 1);
-					if (result != 1) {
-						close(fd);
-						LOG_ERROR<<"Error writing last byte of the file"<<std::endl;
-						exit(EXIT_FAILURE);
+					//another process might have made it bigger already
+					if(get_size()<_file_size && ftruncate(fd,_file_size)==-1){
+						LOG_ERROR<<"Error calling ftruncate() to 'stretch' the file"<<std::endl;
+						throw std::bad_alloc();
+					}
+					//only the new pages
+					void* _v=mmap((char*)v+file_size,_file_size-file_size,writable ? PROT_READ|PROT_WRITE : PROT_READ,MAP_SHARED|MAP_FIXED,fd,file_size);
+					if (_v == MAP_FAILED) {
+						LOG_ERROR<<"Error mmapping the file"<<std::endl;
+						throw std::bad_alloc();
+					}
+					LOG_NOTICE<<"extended mapping at "<<v<<" size:"<<_file_size<<std::endl;
+					file_size=_file_size;
+				}
+				#endif
+				if(n>file_size){
+					size_t _file_size=std::max<size_t>((n+PAGE_SIZE-1)/PAGE_SIZE,1)*PAGE_SIZE;
+					//writing the last byte would clobber data if another process made it bigger already
+					if(get_size()<_file_size){
+						int result = lseek(fd,_file_size-1, SEEK_SET);
+						if (result == -1) {
+							close(fd);
+							LOG_ERROR<<"Error calling lseek() to 'stretch' the file"<<std::endl;
+							exit(EXIT_FAILURE);
+						}
+						result = write(fd, "", 1);
+						if (result != 1) {
+							close(fd);
+							LOG_ERROR<<"Error writing last byte of the file"<<std::endl;
+							exit(EXIT_FAILURE);
+						}
 					}
 					void* _v=(char*)mremap(v,file_size,_file_size,MAP_SHARED,MREMAP_MAYMOVE);
 					if (_v == MAP_FAILED) {
@@ -503,11 +989,114 @@ namespace pool_allocator{
 					LOG_NOTICE<<"new mapping at "<<v<<" size:"<<_file_size<<std::endl;
 					file_size=_file_size;
 				}
-				LOG_DEBUG<<"mmap_allocator::allocate "<<v<<std::endl;
+				POOL_LOG_DEBUG<<"mmap_allocator::allocate "<<v<<std::endl;
 				return (char*)v;
 			}
+			//the end of the mapping goes back to the reserved range (or is unmapped), then the file is truncated
+			bool truncate(size_t n){
+				size_t _file_size=std::max<size_t>((n+PAGE_SIZE-1)/PAGE_SIZE,1)*PAGE_SIZE;
+				if(!writable||_file_size>=file_size) return _file_size==file_size;
+				#ifdef POOL_ALLOCATOR_STABLE_MMAP
+				if(reserved){
+					if(mmap((char*)v+_file_size,file_size-_file_size,PROT_NONE,MAP_PRIVATE|MAP_ANONYMOUS|MAP_NORESERVE|MAP_FIXED,-1,0)==MAP_FAILED) return false;
+				}else
+				#endif
+				if(mremap(v,file_size,_file_size,0)==MAP_FAILED) return false;
+				if(ftruncate(fd,_file_size)==-1) LOG_ERROR<<"Error calling ftruncate() to shrink the file"<<std::endl;
+				LOG_NOTICE<<"mapping at "<<v<<" truncated to "<<_file_size<<std::endl;
+				file_size=_file_size;
+				return true;
+			}
 		};
 		#endif
+		/*
+		*	anonymous memory for volatile pools: transparent huge pages (MADV_HUGEPAGE) to reduce TLB misses,
+		*	optionally pre-faulted, grows in place with mremap so there is no copy and the new pages are 
+		*	already zeroed.
+		*	The range is 2 MiB aligned and advised before it is populated: faulting the pages first
+		*	(MAP_POPULATE) would give small pages the kernel then has to collapse
+		*/ 
+		struct anonymous_allocator_impl{
+			void* v;
+			size_t size;
+			const bool huge_pages;
+			const bool populate;
+			enum{PAGE_SIZE=4096,HUGE_PAGE_SIZE=2*1024*1024};
+			anonymous_allocator_impl(bool huge_pages,bool populate):v(nullptr),size(0),huge_pages(huge_pages),populate(populate){}
+			//n bytes mapped at a multiple of the huge page size
+			static void* map_aligned(size_t n){
+				char* v=(char*)mmap(NULL,n+HUGE_PAGE_SIZE,PROT_READ|PROT_WRITE,MAP_PRIVATE|MAP_ANONYMOUS,-1,0);
+				if(v==MAP_FAILED) return MAP_FAILED;
+				char* a=(char*)(((uintptr_t)v+HUGE_PAGE_SIZE-1)&~(uintptr_t)(HUGE_PAGE_SIZE-1));
+				if(a>v) munmap(v,a-v);
+				if(v+HUGE_PAGE_SIZE>a) munmap(a+n,v+HUGE_PAGE_SIZE-a);
+				return a;
+			}
+			char* allocate(size_t n){
+				if(n>size){
+					size_t unit=huge_pages ? HUGE_PAGE_SIZE : PAGE_SIZE;
+					size_t _size=(n+unit-1)/unit*unit;
+					void* _v;
+					if(!v){
+						_v=huge_pages ? map_aligned(_size) : mmap(NULL,_size,PROT_READ|PROT_WRITE,MAP_PRIVATE|MAP_ANONYMOUS,-1,0);
+					}else{
+						//in place keeps the alignment, otherwise move to a new aligned range
+						_v=mremap(v,size,_size,0);
+						if(_v==MAP_FAILED&&huge_pages){
+							void* a=map_aligned(_size);
+							if(a!=MAP_FAILED) _v=mremap(v,size,_size,MREMAP_MAYMOVE|MREMAP_FIXED,a);
+						}
+						if(_v==MAP_FAILED) _v=mremap(v,size,_size,MREMAP_MAYMOVE);
+					}
+					if(_v==MAP_FAILED){
+						LOG_ERROR<<"Error mapping anonymous memory"<<std::endl;
+						throw std::bad_alloc();
+					}
+					#ifdef MADV_HUGEPAGE
+					if(huge_pages) madvise(_v,_size,MADV_HUGEPAGE);//only a hint
+					#endif
+					if(populate){//the new pages only
+						#ifdef MADV_POPULATE_WRITE
+						if(madvise((char*)_v+size,_size-size,MADV_POPULATE_WRITE)==-1)
+						#endif
+						for(size_t i=size;i<_size;i+=PAGE_SIZE) ((volatile char*)_v)[i]=0;
+					}
+					v=_v;
+					LOG_NOTICE<<"new anonymous mapping at "<<v<<" size:"<<_size<<std::endl;
+					size=_size;
+				}
+				return (char*)v;
+			}
+			bool truncate(size_t n){
+				size_t unit=huge_pages ? HUGE_PAGE_SIZE : PAGE_SIZE;
+				size_t _size=std::max<size_t>((n+unit-1)/unit,1)*unit;
+				if(!v||_size>=size) return _size==size;
+				if(mremap(v,size,_size,0)==MAP_FAILED) return false;
+				LOG_NOTICE<<"anonymous mapping at "<<v<<" truncated to "<<_size<<std::endl;
+				size=_size;
+				return true;
+			}
+		};
+		//T only identifies the pool
+		template<
+			typename T,
+			bool HUGE_PAGES=true,
+			bool POPULATE=false
+		> struct anonymous_allocator{
+			template<typename OTHER_PAYLOAD> struct rebind{
+				typedef anonymous_allocator<OTHER_PAYLOAD,HUGE_PAGES,POPULATE> other;
+			};
+			typedef char* pointer;
+			bool writable=true;
+			static anonymous_allocator_impl* get_impl(){
+				static anonymous_allocator_impl* a=new anonymous_allocator_impl(HUGE_PAGES,POPULATE);
+				return a;
+			}
+			//there is only one range used at any given time, it is resized
+			pointer allocate(size_t n){return get_impl()->allocate(n);}
+			void deallocate(pointer p,size_t n){}
+			static bool truncate(size_t n){return get_impl()->truncate(n);}
+		};
 		template<typename T> static size_t get_hash(){
 			std::hash<std::string> str_hash;
 			auto tmp=str_hash(typeid(T).name());
@@ -522,6 +1111,10 @@ namespace pool_allocator{
 				*/
 				std::ostringstream os;
 				os<<std::setfill('0')<<std::hex<<std::setw(16)<<get_hash<T>();
+				//the width of POOL_ALLOCATOR_POOL_INDEX changes the layout of the pool of pools: one file per width
+				if(std::is_same<T,pool>::value&&sizeof(POOL_ALLOCATOR_POOL_INDEX)!=1) os<<std::dec<<"."<<8*sizeof(POOL_ALLOCATOR_POOL_INDEX);
+				//the layout is chosen by the payload
+				if(soa<T>::value) os<<".soa";
 				return os.str();
 			}
 			//let's have a rebind 
@@ -543,14 +1136,23 @@ namespace pool_allocator{
 			bool writable;
 			static mmap_allocator_impl* get_impl(){
 				//bind as late as possible otherwise compiler complaints
-				static mmap_allocator_impl* a=new mmap_allocator_impl(std::string("db/")+FILE_NAME::template rebind<T>::other::get());
+				static mmap_allocator_impl* a=new mmap_allocator_impl(get_file_name(),get_reserved(),std::is_same<T,pool>::value);
 				return a;
 			}
+			static std::string get_file_name(){return std::string("db/")+FILE_NAME::template rebind<T>::other::get();}
+			static size_t get_file_size(){return get_impl()->get_size();}
+			//address space to reserve, must be set before the file is mapped
+			static size_t& get_reserved(){
+				static size_t r=0;
+				return r;
+			}
+			static void reserve(size_t n){get_reserved()=n;}
 			//we know that there will be only one range used at any given time
 			pointer allocate(size_t n){
 				writable=get_impl()->writable;//a bit kludgy
 				return get_impl()->allocate(n);
 			}
+			static bool truncate(size_t n){return get_impl()->truncate(n);}
 			void deallocate(pointer p,size_t n){
 
 			}
@@ -560,17 +1162,24 @@ namespace pool_allocator{
 			typename T,
 			typename FILE_NAME=file_name<T>
 		> struct mmap_allocator:std::allocator<char>{
+			template<typename OTHER_PAYLOAD> struct rebind{
+				typedef mmap_allocator<OTHER_PAYLOAD,FILE_NAME> other;
+			};
 			bool writable=true;
+			static void reserve(size_t){}
+			static std::string get_file_name(){return std::string();}
+			static size_t get_file_size(){return 0;}
+			static bool truncate(size_t){return false;}
 			char* allocate(size_t n){
-				LOG_DEBUG<<"mmap_allocator::allocate("<<n<<")"<<std::endl;
+				POOL_LOG_DEBUG<<"mmap_allocator::allocate("<<n<<")"<<std::endl;
 				return std::allocator<char>::allocate(n);
 			}
 			void deallocate(char* p,size_t n){
-				LOG_DEBUG<<"mmap_allocator::deallocate("<<p<<","<<n<<")"<<std::endl;
+				POOL_LOG_DEBUG<<"mmap_allocator::deallocate("<<p<<","<<n<<")"<<std::endl;
 			}
 		};
 		#endif
-		typedef ptr<pool,uint8_t,std::allocator<pool>,mmap_allocator<pool>,char> POOL_PTR;//MUST be consistent with POOL_ALLOCATOR definition
+		typedef ptr<pool,POOL_ALLOCATOR_POOL_INDEX,std::allocator<pool>,mmap_allocator<pool>,char> POOL_PTR;//MUST be consistent with POOL_ALLOCATOR definition
 		template<
 			typename _PAYLOAD_,
 			typename _INDEX_,
@@ -700,33 +1309,189 @@ namespace pool_allocator{
 			//that is not correct!!!!
 			typedef std::size_t size_type;
 			typedef std::ptrdiff_t difference_type;
-			#ifdef POOL_ALLOCATOR_THREAD_SAFE
-			static std::mutex m;
-			#endif
 			allocator(){}
 			~allocator(){}
 			//what is the problem with this?
 			typedef cell<PAYLOAD,INDEX,ALLOCATOR,RAW_ALLOCATOR,MANAGEMENT> CELL;
+			static_assert(std::is_same<MANAGEMENT,typename management_layout<PAYLOAD,MANAGEMENT>::type>::value,"the layout is selected by soa<PAYLOAD>");
+			#ifdef POOL_ALLOCATOR_THREAD_SAFE
+			static std::mutex m;
+			/*
+			*	with the lock-free path we also have to wait for the single cell operations
+			*	in progress, they will take the mutex until we are done
+			*/ 
+			struct lock_guard{
+				std::lock_guard<std::mutex> l;
+				lock_guard():l(m){
+					#ifdef POOL_ALLOCATOR_MULTI_PROCESS
+					pool::lock_process<CELL>();
+					#endif
+					#ifndef POOL_ALLOCATOR_NO_LOCK_FREE
+					pool::get_free_stack<CELL>().lock();
+					#endif
+				}
+				~lock_guard(){
+					#ifndef POOL_ALLOCATOR_NO_LOCK_FREE
+					pool::get_free_stack<CELL>().unlock();
+					#endif
+					#ifdef POOL_ALLOCATOR_MULTI_PROCESS
+					pool::unlock_process<CELL>();
+					#endif
+				}
+			};
+			#endif
+			#ifdef POOL_ALLOCATOR_MAGAZINE
+			/*
+			*	per-thread cache of single cells in front of the pool, refilled and flushed in bulk
+			*	so the pool (and c[0].body.info) is only touched every POOL_ALLOCATOR_MAGAZINE_SIZE/2 operations.
+			*	Cells in a magazine are still allocated as far as the pool is concerned: size() leaves them out
+			*	(count kept by get_cached()), the iterators, spans() and snapshot() give them back first, see 
+			*	flush_magazines(); stats() and the counters see them as allocated until flush().
+			*	A cell can be freed by any thread, it just ends up in that thread's magazine.
+			*	Not used by the pool of pools, its cells must all hold a pool struct
+			*/ 
+			static constexpr bool magazine_enabled(){
+				return !pool::journal<CELL>::ENABLED&&!pool::MULTI_PROCESS&&!std::is_same<PAYLOAD,pool>::value;
+			}
+			struct magazine{
+				enum{SIZE=POOL_ALLOCATOR_MAGAZINE_SIZE};
+				INDEX cells[SIZE];
+				size_t n=0;
+				#ifdef POOL_ALLOCATOR_THREAD_SAFE
+				std::mutex m;//only contended by flush()
+				#endif
+				magazine(){
+					#ifdef POOL_ALLOCATOR_THREAD_SAFE
+					lock_guard lock;
+					#endif
+					get_magazines().push_back(this);
+				}
+				~magazine(){
+					#ifdef POOL_ALLOCATOR_THREAD_SAFE
+					lock_guard lock;
+					#endif
+					release(n);
+					auto& v=get_magazines();
+					v.erase(std::find(v.begin(),v.end(),this));
+				}
+				/*
+				*	the allocator must be locked. The cells are stored in reverse so they are handed out 
+				*	in increasing order like without magazine, the batch shrinks when the pool is full
+				*/ 
+				void refill(){
+					size_t m=n;
+					for(size_t k=SIZE/2-n;;k/=2){
+						try{
+							pool::get_pool<CELL>()->template allocate_batch<CELL>(k,[this](INDEX i){cells[n++]=i;});
+							break;
+						}catch(std::bad_alloc&){
+							if(k==1) throw;
+						}
+					}
+					get_cached().fetch_add(n-m,std::memory_order_relaxed);
+					std::reverse(cells,cells+n);
+				}
+				void release(size_t k){
+					n-=k;
+					pool::get_pool<CELL>()->template deallocate_batch<CELL>(cells+n,cells+n+k);
+					get_cached().fetch_sub(k,std::memory_order_relaxed);
+				}
+				INDEX pop(){
+					#ifdef POOL_ALLOCATOR_THREAD_SAFE
+					std::unique_lock<std::mutex> l(m);
+					if(!n){
+						//lock order: allocator then magazine
+						l.unlock();
+						lock_guard lock;
+						l.lock();
+						if(!n) refill();
+					}
+					#else
+					if(!n) refill();
+					#endif
+					get_cached().fetch_sub(1,std::memory_order_relaxed);
+					return cells[--n];
+				}
+				void push(INDEX i){
+					#ifdef POOL_ALLOCATOR_THREAD_SAFE
+					std::unique_lock<std::mutex> l(m);
+					if(n==SIZE){
+						l.unlock();
+						lock_guard lock;
+						l.lock();
+						if(n==SIZE) release(SIZE/2);
+					}
+					#else
+					if(n==SIZE) release(SIZE/2);
+					#endif
+					get_cached().fetch_add(1,std::memory_order_relaxed);
+					cells[n++]=i;
+				}
+			};
+			static std::vector<magazine*>& get_magazines(){
+				static std::vector<magazine*> v;
+				return v;
+			}
+			static magazine& get_magazine(){
+				static thread_local magazine m;
+				return m;
+			}
+			//number of cells held by all the magazines of the pool
+			static std::atomic<size_t>& get_cached(){
+				static std::atomic<size_t> n{0};
+				return n;
+			}
+			#endif
+			//before the pool is observed, the cells held by the magazines would be seen as allocated
+			static void flush_magazines(){
+				#ifdef POOL_ALLOCATOR_MAGAZINE
+				if(magazine_enabled()) flush();
+				#endif
+			}
 			//this is a upper boundary of the maximum size 
 			size_type max_size() const throw(){
 				typedef cell<PAYLOAD,INDEX,ALLOCATOR,RAW_ALLOCATOR,MANAGEMENT> CELL;
 				return CELL::MAX_SIZE;
 			}
+			//the file could only be opened O_RDONLY (or POOL_ALLOCATOR_READ_ONLY)
+			static void check_writable(){
+				typedef cell<PAYLOAD,INDEX,ALLOCATOR,RAW_ALLOCATOR,MANAGEMENT> CELL;
+				if(!pool::get_pool<CELL>()->writable) throw std::runtime_error("read-only pool");
+			}
 			//we have to introduce thread-safety!
 			pointer allocate(size_type n){
+				typedef cell<PAYLOAD,INDEX,ALLOCATOR,RAW_ALLOCATOR,MANAGEMENT> CELL;
+				#ifdef POOL_ALLOCATOR_LATENCY
+				pool::counters::latency::timer t{pool::get_counters<CELL>().allocate_latency};
+				#endif
+				check_writable();
+				#ifdef POOL_ALLOCATOR_MAGAZINE
+				if(magazine_enabled()&&n<=CELL::FACTOR) return pointer(get_magazine().pop()*CELL::FACTOR,0);
+				#endif
 				#ifdef POOL_ALLOCATOR_THREAD_SAFE
-				std::lock_guard<std::mutex> lock(m);
+				#ifndef POOL_ALLOCATOR_NO_LOCK_FREE
+				if(n<=CELL::FACTOR){
+					auto& s=pool::get_free_stack<CELL>();
+					if(s.enter()){
+						INDEX i=s.pop(*pool::get_pool<CELL>());
+						s.leave();
+						if(i) return pointer(i*CELL::FACTOR,0);
+					}
+				}
 				#endif
-				LOG_DEBUG<<"allocate "<<n<<" elements"<<std::endl;
-				typedef cell<PAYLOAD,INDEX,ALLOCATOR,RAW_ALLOCATOR,MANAGEMENT> CELL;
-				return pointer(pool::get_pool<CELL>()->template allocate<CELL>(std::max<size_t>(ceil(1.0*n/CELL::FACTOR),1))*CELL::FACTOR,0);
+				lock_guard lock;
+				#endif
+				POOL_LOG_DEBUG<<"allocate "<<n<<" elements"<<std::endl;
+				return pointer(pool::get_pool<CELL>()->template allocate<CELL>(CELL::cells_for(n))*CELL::FACTOR,0);
 			}
 			pointer allocate_at(INDEX i,size_type n){
+				//the cells must be on the free list to be taken out of it
+				flush();
 				#ifdef POOL_ALLOCATOR_THREAD_SAFE
-				std::lock_guard<std::mutex> lock(m);
+				lock_guard lock;
 				#endif
 				typedef cell<PAYLOAD,INDEX,ALLOCATOR,RAW_ALLOCATOR,MANAGEMENT> CELL;
-				return pointer(pool::get_pool<CELL>()->template allocate_at<CELL>(i,std::max<size_t>(ceil(1.0*n/CELL::FACTOR),1))*CELL::FACTOR,0);
+				return pointer(pool::get_pool<CELL>()->template allocate_at<CELL>(i,CELL::cells_for(n))*CELL::FACTOR,0);
 			}
 			//will wrap when pointer reaches last
 			pointer ring_allocate(INDEX last){
@@ -738,55 +1503,210 @@ namespace pool_allocator{
 					if(!next.index || next.index > last) next.index=1;
 					//why doesn't this compile???????
 					//if(next==nullptr) ++next;
-					LOG_DEBUG<<"deallocate cell "<<(int)next.index<<std::endl;
+					POOL_LOG_DEBUG<<"deallocate cell "<<(int)next.index<<std::endl;
 					deallocate(next,1);
-					LOG_DEBUG<<"new size:"<<size()<<std::endl;
+					POOL_LOG_DEBUG<<"new size:"<<size()<<std::endl;
 				}
 				return tmp;
 			}
 			//what if derived_pointer? should cast but maybe not
 			void deallocate(pointer p,size_type n){
+				typedef cell<PAYLOAD,INDEX,ALLOCATOR,RAW_ALLOCATOR,MANAGEMENT> CELL;
+				#ifdef POOL_ALLOCATOR_LATENCY
+				pool::counters::latency::timer t{pool::get_counters<CELL>().deallocate_latency};
+				#endif
+				check_writable();
+				#ifdef POOL_ALLOCATOR_MAGAZINE
+				if(magazine_enabled()&&n<=CELL::FACTOR){
+					get_magazine().push(p.index/CELL::FACTOR);
+					return;
+				}
+				#endif
 				#ifdef POOL_ALLOCATOR_THREAD_SAFE
-				std::lock_guard<std::mutex> lock(m);
+				#ifndef POOL_ALLOCATOR_NO_LOCK_FREE
+				if(n<=CELL::FACTOR){
+					auto& s=pool::get_free_stack<CELL>();
+					if(s.enter()){
+						s.push(*pool::get_pool<CELL>(),p.index/CELL::FACTOR);
+						s.leave();
+						return;
+					}
+				}
 				#endif
-				typedef cell<PAYLOAD,INDEX,ALLOCATOR,RAW_ALLOCATOR,MANAGEMENT> CELL;
-				pool::get_pool<CELL>()->template deallocate<CELL>(p.index/CELL::FACTOR,std::max<size_t>(ceil(1.0*n/CELL::FACTOR),1));
+				lock_guard lock;
+				#endif
+				pool::get_pool<CELL>()->template deallocate<CELL>(p.index/CELL::FACTOR,CELL::cells_for(n));
 			}
-			//if this function is needed it means the container does not use the pointer type and persistence will fail
-			/*void deallocate(value_type* p,size_type n){
-
-			}*/
-			//we have to rebind the RAW_ALLOCATOR as well!!!!! except if std::allocator, 
-			//why can't we rebind std::allocator: because we always use std::allocator<char>, mmap_allocator needs a type to 
-			//get unique file
-			template<class OTHER_PAYLOAD> struct rebind{
-				typedef typename IfThenElse<
-					std::is_same<RAW_ALLOCATOR,std::allocator<char>>::value,
-					RAW_ALLOCATOR, 
-					typename RAW_ALLOCATOR::template rebind<OTHER_PAYLOAD>::other
-				>::ResultT OTHER_RAW_ALLOCATOR;
-				typedef allocator<OTHER_PAYLOAD,INDEX,ALLOCATOR,OTHER_RAW_ALLOCATOR,MANAGEMENT> other;
-			};
-			static typename ALLOCATOR::pointer get_pool(){
-				typedef cell<PAYLOAD,INDEX,ALLOCATOR,RAW_ALLOCATOR,MANAGEMENT> CELL;
-				return pool::get_pool<CELL>();
+			/*
+			*	n independent single elements, they are written to out as pointers
+			*	much cheaper than n calls to allocate(1): the pool header is only updated once
+			*/ 
+			template<typename OUT> OUT allocate_batch(size_type n,OUT out){
+				#ifdef POOL_ALLOCATOR_THREAD_SAFE
+				lock_guard lock;
+				#endif
+				pool::get_pool<CELL>()->template allocate_batch<CELL>(n,[&out](INDEX i){*out++=pointer(i*CELL::FACTOR,0);});
+				return out;
 			}
+			//each pointer must have been allocated as a single element
+			template<typename IT> void deallocate_batch(IT first,IT last){
+				std::vector<INDEX> v;
+				for(;first!=last;++first) v.push_back(first->index/CELL::FACTOR);
+				#ifdef POOL_ALLOCATOR_THREAD_SAFE
+				lock_guard lock;
+				#endif
+				pool::get_pool<CELL>()->template deallocate_batch<CELL>(v.begin(),v.end());
+			}
+			//make room for n more cells so a bulk load grows the pool only once
+			void reserve(size_type n){
+				#ifdef POOL_ALLOCATOR_THREAD_SAFE
+				lock_guard lock;
+				#endif
+				pool::get_pool<CELL>()->template reserve<CELL>((n+CELL::FACTOR-1)/CELL::FACTOR);
+			}
+			//give the cells held by the magazines and the lock-free stack back to the free list, stats() and the counters are then exact
+			static void flush(){
+				#ifdef POOL_ALLOCATOR_THREAD_SAFE
+				lock_guard lock;
+				#endif
+				#ifdef POOL_ALLOCATOR_MAGAZINE
+				for(auto m:get_magazines()){
+					#ifdef POOL_ALLOCATOR_THREAD_SAFE
+					std::lock_guard<std::mutex> l(m->m);
+					#endif
+					m->release(m->n);
+				}
+				#endif
+				#if defined(POOL_ALLOCATOR_THREAD_SAFE) && !defined(POOL_ALLOCATOR_NO_LOCK_FREE)
+				pool::get_free_stack<CELL>().flush(*pool::get_pool<CELL>());
+				#endif
+			}
+			//release the free memory at the end of the pool, returns the number of bytes
+			static size_t trim(){
+				#ifdef POOL_ALLOCATOR_THREAD_SAFE
+				lock_guard lock;
+				#endif
+				return pool::get_pool<CELL>()->template trim<CELL>();
+			}
+			/*
+			*	defragment the pool and shrink its buffer (and file), see pool::compact()
+			*	every pointer kept by the caller must then be translated: p.index=remap[p.index]
+			*/ 
+			static std::vector<INDEX> compact(){
+				flush();
+				#ifdef POOL_ALLOCATOR_THREAD_SAFE
+				lock_guard lock;
+				#endif
+				auto r=pool::get_pool<CELL>()->template compact<CELL>();
+				if(CELL::FACTOR==1) return r;
+				//several payloads per cell
+				std::vector<INDEX> v(r.size()*CELL::FACTOR,0);
+				for(size_t i=0;i<v.size();++i)
+					if(r[i/CELL::FACTOR]) v[i]=r[i/CELL::FACTOR]*CELL::FACTOR+i%CELL::FACTOR;
+				return v;
+			}
+			/*
+			*	widen the index of a persisted pool: OLD_ALLOCATOR is the same allocator with the narrower index,
+			*	neither must have been used by this process yet, see pool::migrate_index()
+			*
+			*		persistent_allocator_managed<node,uint32_t>::migrate_from<persistent_allocator_managed<node,uint8_t>>();
+			*
+			*	WARNING: the payload is copied byte for byte and keeps its type. A payload holding pointers to its own
+			*	pool (OLD_ALLOCATOR::pointer, a list or tree node) still holds pointers of the old cell type after the
+			*	migration, they point to a pool that no longer exists. Such payloads cannot be migrated, the structure
+			*	must be rebuilt in the new pool. This is not detected: only payloads without pointers to their own pool
+			*	(plain data, pointers to other pools) are safe.
+			*/ 
+			template<typename OLD_ALLOCATOR> static size_t migrate_from(){
+				static_assert(!raw_allocator_traits<RAW_ALLOCATOR>::VOLATILE,"only persistent pools can be migrated");
+				std::string name=raw_allocator_traits<RAW_ALLOCATOR>::file_name();
+				if(name!=raw_allocator_traits<typename OLD_ALLOCATOR::_RAW_ALLOCATOR_>::file_name()) throw std::runtime_error("pools in different files");
+				return pool::migrate_index<typename OLD_ALLOCATOR::CELL,CELL>(name);
+			}
+			//if this function is needed it means the container does not use the pointer type and persistence will fail
+			/*void deallocate(value_type* p,size_type n){
+
+			}*/
+			//we have to rebind the RAW_ALLOCATOR as well!!!!! except if std::allocator, 
+			//why can't we rebind std::allocator: because we always use std::allocator<char>, mmap_allocator needs a type to 
+			//get unique file
+			template<class OTHER_PAYLOAD> struct rebind{
+				typedef typename IfThenElse<
+					std::is_same<RAW_ALLOCATOR,std::allocator<char>>::value,
+					RAW_ALLOCATOR, 
+					typename RAW_ALLOCATOR::template rebind<OTHER_PAYLOAD>::other
+				>::ResultT OTHER_RAW_ALLOCATOR;
+				typedef allocator<OTHER_PAYLOAD,INDEX,ALLOCATOR,OTHER_RAW_ALLOCATOR,typename management_layout<OTHER_PAYLOAD,MANAGEMENT>::type> other;
+			};
+			static typename ALLOCATOR::pointer get_pool(){
+				typedef cell<PAYLOAD,INDEX,ALLOCATOR,RAW_ALLOCATOR,MANAGEMENT> CELL;
+				return pool::get_pool<CELL>();
+			}
+			//activity of the pool in this process, see pool::counters
+			static const pool::counters& get_counters(){return pool::get_counters<CELL>();}
+			//free list shape and activity of the pool, see pool::stats
+			static pool::stats stats(){
+				#ifdef POOL_ALLOCATOR_THREAD_SAFE
+				lock_guard lock;
+				#endif
+				return pool::get_pool<CELL>()->template get_stats<CELL>();
+			}
+			//number of times the buffer has moved, raw pointers to payloads do not survive a move
+			static size_t generation(){return pool::base<CELL>::generation;}
 			//could also specialize std::hash<allocator> but maybe confusing
 			static size_t get_hash(){
 				auto p=get_pool();
 				std::experimental::string_view str(p->buffer,p->buffer_size);
 				return std::hash<std::experimental::string_view>{}(str);
 			}
-			template<typename... Args> void construct(pointer p,Args... args){
-				LOG_DEBUG<<"construct at "<<(int)p.index<<"("<<(void*)p.operator->()<<")"<<std::endl;
+			//the arguments are forwarded: a payload holding a rel_ptr can be copied from another payload of the pool
+			template<typename... Args> void construct(pointer p,Args&&... args){
+				POOL_LOG_DEBUG<<"construct at "<<(int)p.index<<"("<<(void*)p.operator->()<<")"<<std::endl;
 				#ifdef FIX_AMBIGUITY
-				new((PAYLOAD*)p) value_type(args...);
+				new((PAYLOAD*)p) value_type(std::forward<Args>(args)...);
 				#else
-				new(p) value_type(args...);
+				new(p) value_type(std::forward<Args>(args)...);
+				#endif
+				mark_dirty(p);
+			}
+			//the payload has been modified through the pointer, the next checkpoint will write it
+			static void mark_dirty(pointer p){
+				if(raw_allocator_traits<RAW_ALLOCATOR>::VOLATILE) return;
+				auto pp=get_pool();
+				pool::mark_dirty<CELL>(p.index*pp->stride+pp->payload_offset,sizeof(PAYLOAD));
+			}
+			/*
+			*	write the modified pages back to the file, with sync they are on disk when it returns
+			*	otherwise the write is only scheduled
+			*/ 
+			static size_t checkpoint(bool sync=false){
+				if(raw_allocator_traits<RAW_ALLOCATOR>::VOLATILE) return 0;
+				#ifdef POOL_ALLOCATOR_THREAD_SAFE
+				lock_guard lock;
+				#endif
+				return pool::get_pool<CELL>()->template checkpoint<CELL>(sync);
+			}
+			/*
+			*	contiguous runs of allocated payloads, for standard algorithms and vectorized loops,
+			*	see pool::spans() for pools with several payloads per cell
+			*/ 
+			static std::vector<pool::strided_span<PAYLOAD>> spans(){
+				flush_magazines();
+				#ifdef POOL_ALLOCATOR_THREAD_SAFE
+				lock_guard lock;
+				#endif
+				return pool::get_pool<CELL>()->template spans<CELL>();
+			}
+			//consistent copy of the pool, cheap if the file system can clone files
+			static pool::snapshot<CELL> snapshot(){
+				flush_magazines();
+				#ifdef POOL_ALLOCATOR_THREAD_SAFE
+				lock_guard lock;
 				#endif
+				return pool::snapshot<CELL>(*pool::get_pool<CELL>());
 			}
 			void destroy(pointer p){
-				LOG_DEBUG<<"destroy at "<<(int)p.index<<std::endl;
+				POOL_LOG_DEBUG<<"destroy at "<<(int)p.index<<std::endl;
 				p->~value_type();
 			}
 			//this might cause problem, is the pointer still valid? it should be because when using vector a whole block is allocated
@@ -802,30 +1722,85 @@ namespace pool_allocator{
 			*/
 			bool operator==(const allocator&)const{return true;}
 			bool operator!=(const allocator&)const{return false;}
+			//constant time, the cells held by the magazines are not counted
 			size_t size() const{
+				#ifdef POOL_ALLOCATOR_MAGAZINE
+				if(magazine_enabled()){
+					//read first: a concurrent refill can only make the result too large
+					size_t m=get_cached().load(std::memory_order_relaxed);
+					size_t u=used();
+					return u>m ? u-m : 0;
+				}
+				#endif
+				return used();
+			}
+			//allocated cells as seen by the pool, including the ones held by the magazines
+			static size_t used(){
 				typedef cell<PAYLOAD,INDEX,ALLOCATOR,RAW_ALLOCATOR,MANAGEMENT> CELL;
 				return pool::get_pool<CELL>()->template get_cells<CELL>()[0].body.info.size;
 			}
 			//typed iterator
+			typedef cell_iterator<PAYLOAD,INDEX,ALLOCATOR,RAW_ALLOCATOR,MANAGEMENT,true> const_iterator;
+			#ifdef POOL_ALLOCATOR_READ_ONLY
+			typedef const_iterator iterator;
+			#else
 			typedef cell_iterator<PAYLOAD,INDEX,ALLOCATOR,RAW_ALLOCATOR,MANAGEMENT> iterator;
-			typedef iterator const_iterator;
-			iterator begin(){return iterator();}
+			#endif
+			/*
+			*	visit the allocated payloads with n_threads workers (0: one per core), f is called 
+			*	concurrently and the pool must not change until it returns, see pool::parallel_scan()
+			*/ 
+			template<typename F> static void parallel_for_each(F f,size_t n_threads=0){
+				static_assert(CELL::MANAGED,"only managed pools know their allocated cells");
+				flush_magazines();
+				pool::get_pool<CELL>()->template parallel_for_each<CELL>(f,n_threads);
+			}
+			iterator begin(){
+				flush_magazines();
+				return iterator();
+			}
 			//would be nice if end iterator would be cast to null pointer? does it make sense?
-			iterator end(){return iterator(size());}
-			const_iterator cbegin(){return const_iterator();}
-			const_iterator cend(){return const_iterator(size());}
+			iterator end(){return iterator(used());}
+			const_iterator cbegin(){
+				flush_magazines();
+				return const_iterator();
+			}
+			const_iterator cend(){return const_iterator(used());}
 			//experimental, UNSAFE!!!
+			#ifdef POOL_ALLOCATOR_READ_ONLY
+			const PAYLOAD& operator[](size_t index){
+			#else
 			PAYLOAD& operator[](size_t index){
+			#endif
 				return *pointer(index,0);
 			}
 			
-			//helper function
+			/*
+			*	helper function, the arguments are copied before allocating because the buffer can move:
+			*	they cannot be (or contain) a rel_ptr, those are only valid inside the pool
+			*/ 
 			template<typename... Args> static pointer construct_allocate(Args... args){
 				allocator a;
 				auto p=a.allocate(1);	
 				a.construct(p,args...);
 				return p;
 			}
+			template<typename OUT,typename... Args> static OUT construct_allocate_batch(size_type n,OUT out,Args... args){
+				allocator a;
+				return a.allocate_batch(n,construct_iterator<OUT,Args...>{out,std::make_tuple(args...)});
+			}
+			template<typename OUT,typename... Args> struct construct_iterator{
+				OUT out;
+				std::tuple<Args...> args;
+				construct_iterator& operator*(){return *this;}
+				construct_iterator& operator++(int){return *this;}
+				construct_iterator& operator=(pointer p){
+					std::apply([&p](Args&... a){new(p.operator->()) value_type(a...);},args);
+					*out++=p;
+					return *this;
+				}
+				operator OUT() const{return out;}
+			};
 			template<typename... Args> static pointer construct_allocate_at(INDEX i,Args... args){
 				allocator a;
 				auto p=a.allocate_at(i,1);	
@@ -848,16 +1823,54 @@ namespace pool_allocator{
 					RAW_ALLOCATOR, 
 					typename RAW_ALLOCATOR::template rebind<OTHER_PAYLOAD>::other
 				>::ResultT OTHER_RAW_ALLOCATOR;
-				typedef allocator<OTHER_PAYLOAD,INDEX,ALLOCATOR,OTHER_RAW_ALLOCATOR,MANAGEMENT> other;
+				typedef allocator<OTHER_PAYLOAD,INDEX,ALLOCATOR,OTHER_RAW_ALLOCATOR,typename management_layout<OTHER_PAYLOAD,MANAGEMENT>::type> other;
 			};
 		};
 		//
-		//let's store pools in a pool...maximum 255 pools for now
+		//let's store pools in a pool...maximum 255 pools with the default POOL_ALLOCATOR_POOL_INDEX
 		//typedef cell<uint8_t,pool,std::allocator<pool>,std::allocator<char>,char> POOL_CELL;
-		typedef cell<pool,uint8_t,std::allocator<pool>,mmap_allocator<pool>,char> POOL_CELL;
-		typedef allocator<pool,uint8_t,std::allocator<pool>,mmap_allocator<pool>,char> POOL_ALLOCATOR;
+		typedef cell<pool,POOL_ALLOCATOR_POOL_INDEX,std::allocator<pool>,mmap_allocator<pool>,char> POOL_CELL;
+		typedef allocator<pool,POOL_ALLOCATOR_POOL_INDEX,std::allocator<pool>,mmap_allocator<pool>,char> POOL_ALLOCATOR;
+		typedef size_t (*f_ptr)(pool&);
+		#ifdef POOL_ALLOCATOR_MULTI_PROCESS
+		enum{MULTI_PROCESS=true};
+		/*
+		*	several processes share the pool of pools: the buffer address, the size mapped by this process
+		*	and the function pointer are process-local, the pool struct only keeps its slot in a per-process 
+		*	table (its index in the pool of pools, 0 for the pool of pools itself)
+		*/ 
+		struct local_state{
+			char* buffer=nullptr;
+			size_t buffer_size=0;
+			f_ptr get_size_generic=nullptr;
+		};
+		//one per cell of the pool of pools
+		static_assert(sizeof(POOL_ALLOCATOR_POOL_INDEX)<=2,"the process-local table has one slot per pool");
+		enum{MAX_POOLS=1<<(8*sizeof(POOL_ALLOCATOR_POOL_INDEX))};
+		static local_state* get_local_states(){
+			static local_state s[MAX_POOLS];
+			return s;
+		}
+		template<typename T,T local_state::*M> struct local{
+			size_t slot;
+			operator T() const{return get_local_states()[slot].*M;}
+			local& operator=(T t){
+				get_local_states()[slot].*M=t;
+				return *this;
+			}
+		};
+		struct local_buffer:local<char*,&local_state::buffer>{
+			using local<char*,&local_state::buffer>::operator=;
+			template<typename T> explicit operator T*() const{return (T*)(char*)*this;}
+			char* operator+(size_t n) const{return (char*)*this+n;}
+		};
+		local_buffer buffer;
+		local<size_t,&local_state::buffer_size> buffer_size;
+		#else
+		enum{MULTI_PROCESS=false};
 		char* buffer;
 		size_t buffer_size;//in byte, this causes problem when pool's buffer is not persisted 
+		#endif
 		const size_t cell_size;//in byte
 		const size_t stride;
 		const size_t payload_offset;
@@ -872,15 +1885,28 @@ namespace pool_allocator{
 		*	the only problem is if we save the pool but not the buffer, this could happen?
 		*	that would make it available to generic iterators, alternatively we could have a function pointer
 		*/ 
-		typedef size_t (*f_ptr)(pool&);
+		#ifdef POOL_ALLOCATOR_MULTI_PROCESS
+		local<f_ptr,&local_state::get_size_generic> get_size_generic;
+		#else
 		f_ptr get_size_generic;
+		#endif
 		template<typename CELL> static size_t get_size(pool& p){return p.get_cells<CELL>()[0].body.info.size;}
 
 		template<
 			typename CELL,
 			typename PAYLOAD=typename CELL::PAYLOAD
 		> struct helper{
+			//persistent pools take part in checkpoint_all(), must be called once the pool is ready
+			static void register_pool(){
+				register_stats(&allocator<typename CELL::PAYLOAD,typename CELL::INDEX,typename CELL::ALLOCATOR,typename CELL::RAW_ALLOCATOR,typename CELL::MANAGEMENT>::stats);
+				if(raw_allocator_traits<typename CELL::RAW_ALLOCATOR>::VOLATILE) return;
+				register_checkpoint(&allocator<typename CELL::PAYLOAD,typename CELL::INDEX,typename CELL::ALLOCATOR,typename CELL::RAW_ALLOCATOR,typename CELL::MANAGEMENT>::checkpoint);
+			}
 			static typename CELL::ALLOCATOR::pointer go(){
+				#ifdef POOL_ALLOCATOR_MULTI_PROCESS
+				//two processes must not create the same pool
+				scoped_flock l(get_process_mutex<POOL_CELL>().fd);
+				#endif
 				/*
 				*	maybe the pool has been persisted 
 				*/ 
@@ -897,7 +1923,7 @@ namespace pool_allocator{
 				size_t buffer_size=128*cell_size;
 				typename CELL::ALLOCATOR a;
 				//LOG<<"looking for pool `"<<typeid(typename CELL::PAYLOAD).name()<<"'"<<endl;
-				LOG_DEBUG<<"looking for pool `"<<typeid(CELL).name()<<"'\t"<<std::hex<<type_id<<std::dec<<"\t"<<a.size()<<std::endl;
+				POOL_LOG_DEBUG<<"looking for pool `"<<typeid(CELL).name()<<"'\t"<<std::hex<<type_id<<std::dec<<"\t"<<a.size()<<std::endl;
 				//what if not iterable?
 				auto i=std::find_if(a.cbegin(),a.cend(),[=](const pool& p){return p.type_id==type_id;});
 				if(i==a.cend()){
@@ -905,43 +1931,63 @@ namespace pool_allocator{
 					typename CELL::RAW_ALLOCATOR raw;//what is the payload?
 					//LOG<<"RAW_ALLOCATOR:"<<typeid(typename CELL::RAW_ALLOCATOR::value_type).name()<<endl;
 					//we could simplify a lot by giving filename to allocator
+					raw_allocator_traits<typename CELL::RAW_ALLOCATOR>::reserve(pool::max_reserve<CELL>());
 					auto buffer=raw.allocate(buffer_size);//should specialize so we can 
-					if(std::is_same<typename CELL::RAW_ALLOCATOR,std::allocator<char>>::value){
+					/*
+					*	every process derives the size from the file, so does a process that finds a file 
+					*	without its pool struct (pool of pools deleted, index migrated, see migrate_index())
+					*/ 
+					if(!raw_allocator_traits<typename CELL::RAW_ALLOCATOR>::VOLATILE){//volatile memory is not initialized yet
+						//a page holds more cells than a narrow index can reach
+						size_t file_size=std::min<size_t>(raw_allocator_traits<typename CELL::RAW_ALLOCATOR>::file_size()/cell_size,CELL::MAX_BUFFER_SIZE)*cell_size;
+						#ifndef POOL_ALLOCATOR_MULTI_PROCESS
+						if(((CELL*)buffer)[0].body.info.size||((CELL*)buffer)[0].body.info.next)
+						#endif
+						buffer_size=std::max<size_t>(buffer_size,file_size);
+					}
+					if(!raw_allocator_traits<typename CELL::RAW_ALLOCATOR>::IN_PLACE){
 						LOG_NOTICE<<"resetting volatile memory"<<std::endl;
 						memset(buffer,0,buffer_size);
 					}
 					CELL *c=(CELL*)buffer;
-					if(c[0].body.info.size==0&&c[0].body.info.next==0){
+					bool writable=raw_allocator_traits<typename CELL::RAW_ALLOCATOR>::writable(raw);
+					if(writable) get_journal<CELL>().recover(c);
+					if(writable&&c[0].body.info.size==0&&c[0].body.info.next==0){
 						LOG_NOTICE<<"resetting the buffer"<<std::endl;
+						if constexpr(CELL::SPLIT) CELL::reset();
 						c[0].body.info.size=0;//new pool
 						c[0].body.info.next=1;
 						c[1].body.info.size=buffer_size/sizeof(CELL)-1;
 						c[1].body.info.next=0;
 					}
 					/*
- 					*	warn if allocator uses local copy	
- 					*	it is more serious than that: if the main pool is read-only all the other pools must be made read-only as well!
+ 					*	the pool of pools is a private mapping when read-only, the new pool would not be persisted	
  					*/
-					if(!pool::template get_pool<POOL_CELL>()->writable) LOG_WARNING<<"Warning: change only made to local copy!"<<std::endl;
+					if(!pool::template get_pool<POOL_CELL>()->writable) throw std::runtime_error("pool not found in read-only database");
 					auto p=a.allocate(1);
-					if(std::is_same<typename CELL::RAW_ALLOCATOR,std::allocator<char>>::value)
+					if(raw_allocator_traits<typename CELL::RAW_ALLOCATOR>::VOLATILE)
 						LOG_NOTICE<<"create new pool at index "<<(size_t)p.index<<std::endl;
 					else
 						LOG_NOTICE<<"create new persistent pool at index "<<(size_t)p.index<<std::endl;
 					f_ptr f=pool::get_size<CELL>;
-					a.construct(p,buffer,buffer_size,cell_size,stride,offsetof(CELL,body),type_id,true,CELL::MANAGED,f/*pool::get_size<CELL>*/);
+					a.construct(p,buffer,buffer_size,cell_size,stride,offsetof(CELL,body),type_id,writable,CELL::MANAGED&&!CELL::SPLIT,f/*pool::get_size<CELL>*/,p.index);
+					register_pool();
 					return p;
 				}else{
 					LOG_NOTICE<<"pool found at index "<<(size_t)i.cell_index<<std::endl;
 					typename CELL::RAW_ALLOCATOR raw;
+					raw_allocator_traits<typename CELL::RAW_ALLOCATOR>::reserve(pool::max_reserve<CELL>());
 					auto buffer=raw.allocate(buffer_size);//at this stage we know if it is writable or not
-					if(std::is_same<typename CELL::RAW_ALLOCATOR,std::allocator<char>>::value){
+					if(!raw_allocator_traits<typename CELL::RAW_ALLOCATOR>::IN_PLACE){
 						LOG_NOTICE<<"resetting volatile memory"<<std::endl;
 						memset(buffer,0,buffer_size);
 					}
 					CELL *c=(CELL*)buffer;
-					if(c[0].body.info.size==0&&c[0].body.info.next==0){//also used if file has been deleted
+					bool writable=raw_allocator_traits<typename CELL::RAW_ALLOCATOR>::writable(raw);
+					if(writable) get_journal<CELL>().recover(c);
+					if(writable&&c[0].body.info.size==0&&c[0].body.info.next==0){//also used if file has been deleted
 						LOG_NOTICE<<"resetting the buffer"<<std::endl;
+						if constexpr(CELL::SPLIT) CELL::reset();
 						c[0].body.info.size=0;//new pool
 						c[0].body.info.next=1;
 						c[1].body.info.size=buffer_size/sizeof(CELL)-1;
@@ -950,25 +1996,33 @@ namespace pool_allocator{
 					//we need a pointer to the pool	
 					typename CELL::ALLOCATOR::pointer p(i);
 					//sanity check: has anything changed?
-					LOG_DEBUG<<p->cell_size<<" vs "<<cell_size<<std::endl;
-					LOG_DEBUG<<p->payload_offset<<" vs "<<offsetof(CELL,body)<<std::endl;
-					LOG_DEBUG<<p->iterable<<" vs "<<CELL::MANAGED<<std::endl;
-					if(p->cell_size==cell_size&&p->stride==stride&&p->payload_offset==offsetof(CELL,body)&&p->iterable==CELL::MANAGED){
+					POOL_LOG_DEBUG<<p->cell_size<<" vs "<<cell_size<<std::endl;
+					POOL_LOG_DEBUG<<p->payload_offset<<" vs "<<offsetof(CELL,body)<<std::endl;
+					POOL_LOG_DEBUG<<p->iterable<<" vs "<<CELL::MANAGED<<std::endl;
+					if(p->cell_size==cell_size&&p->stride==stride&&p->payload_offset==offsetof(CELL,body)&&p->iterable==(CELL::MANAGED&&!CELL::SPLIT)){
 						/*
  						*	this is a problem if multiple processes use the same db: the last
  						*	process started will cause segfault in running process, is there anywhere
- 						*	else we can store that data?
+ 						*	else we can store that data? with POOL_ALLOCATOR_MULTI_PROCESS it is process-local
  						*	It would also be nice to be able to make the database read-only for testing purpose
  						*/
 						//we only have to refresh the buffer and function pointers
 						LOG_NOTICE<<"modifying pool struct..."<<std::endl;
-						p->buffer=buffer;//this will segfault if mounted read-only, what can we do????
+						#ifdef POOL_ALLOCATOR_MULTI_PROCESS
+						//only the slot is written to the shared struct, it is the same for every process
+						p->attach(p.index,buffer,buffer_size,pool::get_size<CELL>);
+						p->template remap<CELL>();
+						#else
+						p->buffer=buffer;//the pool of pools is a private mapping if read-only
 						p->get_size_generic=pool::get_size<CELL>;
+						#endif
+						if(!writable) p->writable=false;
 						// we also have to reset buffer_size if not persisted
 						//invoke trigger, the problem is that 
 						//pool_loaded<PAYLOAD>::go();//shall we pass some information?
-						if(std::is_same<typename CELL::RAW_ALLOCATOR,std::allocator<char>>::value)
+						if(raw_allocator_traits<typename CELL::RAW_ALLOCATOR>::VOLATILE)
 							p->buffer_size=buffer_size;
+						register_pool();
 						return p;//could we return a different pointer? dangerous: the index is used to allocate rdfs::Class
 					}else{
 						throw std::runtime_error("persisted class has been modified");
@@ -984,7 +2038,7 @@ namespace pool_allocator{
 			typename CELL
 		> struct helper<CELL,pool>{
 			static typename CELL::ALLOCATOR::pointer go(){
-				LOG_DEBUG<<"pool of pools"<<std::endl;
+				POOL_LOG_DEBUG<<"pool of pools"<<std::endl;
 				std::hash<std::string> str_hash;
 				size_t type_id=str_hash(typeid(pool).name());//use the payload instead of cell type for consistency with filename
 				size_t cell_size=sizeof(CELL);
@@ -998,16 +2052,10 @@ namespace pool_allocator{
 				size_t buffer_size=128*cell_size;//this is dangerous because the file_size might be bigger!
 				#endif
 				typename CELL::RAW_ALLOCATOR raw;
+				raw_allocator_traits<typename CELL::RAW_ALLOCATOR>::reserve(pool::max_reserve<CELL>());
 				auto buffer=raw.allocate(buffer_size);//what about allocating CELL's instead of char?, it would have the advantage of aligning the data
-				if(!raw.writable){
-					LOG_NOTICE<<"copying memory-mapped file to RAM"<<std::endl;
-					auto tmp=new char[buffer_size];
-					memcpy(tmp,buffer,buffer_size);
-					buffer=tmp;//we wont use the mapping	
-					/*
- 					*	there should be warning messages when any cell in this pool will be modified
- 					*/ 
-				}	
+				//read-only: the mapping is private, only the pages of modified pool structs are copied
+				if(raw.writable) get_journal<CELL>().recover((CELL*)buffer);
 				CELL *c=(CELL*)buffer;
 				if(c[0].body.info.size==0&&c[0].body.info.next==0){
 					c[0].body.info.size=0;//new pool
@@ -1025,18 +2073,50 @@ namespace pool_allocator{
 
 		template<typename CELL> static typename CELL::ALLOCATOR::pointer create(){return helper<CELL>::go();}
 
-		pool(char* buffer,size_t buffer_size,size_t cell_size,size_t stride,size_t payload_offset,size_t type_id,bool writable,bool iterable,f_ptr get_size_generic):buffer(buffer),buffer_size(buffer_size),cell_size(cell_size),stride(stride),payload_offset(payload_offset),type_id(type_id),writable(writable),iterable(iterable),get_size_generic(get_size_generic){
+		pool(char* buffer,size_t buffer_size,size_t cell_size,size_t stride,size_t payload_offset,size_t type_id,bool writable,bool iterable,f_ptr get_size_generic,size_t slot=0):cell_size(cell_size),stride(stride),payload_offset(payload_offset),type_id(type_id),writable(writable),iterable(iterable){
+			attach(slot,buffer,buffer_size,get_size_generic);
 			LOG_NOTICE<<"new pool "<<(void*)buffer<<std::endl;
-			LOG_DEBUG<<"\tbuffer size:"<<buffer_size<<"\n";
-			LOG_DEBUG<<"\tcell size:"<<cell_size<<"\n";
-			LOG_DEBUG<<"\tstride:"<<stride<<"\n";
-			LOG_DEBUG<<"\tpayload offset:"<<payload_offset<<"\n";
-			LOG_DEBUG<<"\ttype id:"<<std::hex<<type_id<<std::dec<<"\n";
-			LOG_DEBUG<<"\twritable:"<<writable<<"\n";
-			LOG_DEBUG<<"\titerable:"<<iterable<<"\n";
+			POOL_LOG_DEBUG<<"\tbuffer size:"<<buffer_size<<"\n";
+			POOL_LOG_DEBUG<<"\tcell size:"<<cell_size<<"\n";
+			POOL_LOG_DEBUG<<"\tstride:"<<stride<<"\n";
+			POOL_LOG_DEBUG<<"\tpayload offset:"<<payload_offset<<"\n";
+			POOL_LOG_DEBUG<<"\ttype id:"<<std::hex<<type_id<<std::dec<<"\n";
+			POOL_LOG_DEBUG<<"\twritable:"<<writable<<"\n";
+			POOL_LOG_DEBUG<<"\titerable:"<<iterable<<"\n";
 		}
 		~pool(){
-			LOG_DEBUG<<"~pool()"<<std::endl;
+			POOL_LOG_DEBUG<<"~pool()"<<std::endl;
+		}
+		//set what only makes sense in this process
+		void attach([[maybe_unused]] size_t slot,char* buffer,size_t buffer_size,f_ptr get_size_generic){
+			#ifdef POOL_ALLOCATOR_MULTI_PROCESS
+			this->buffer.slot=slot;
+			this->buffer_size.slot=slot;
+			this->get_size_generic.slot=slot;
+			#endif
+			this->buffer=buffer;
+			this->buffer_size=buffer_size;
+			this->get_size_generic=get_size_generic;
+		}
+		/*
+		*	another process might have grown the file: map the new cells, must be called with the 
+		*	allocator lock held (the buffer can move) or before the pool is published, see lock_process()
+		*/ 
+		template<typename CELL> void remap(){
+			#ifdef POOL_ALLOCATOR_MULTI_PROCESS
+			if(raw_allocator_traits<typename CELL::RAW_ALLOCATOR>::VOLATILE) return;
+			size_t n=shared_size<CELL>();
+			if(n<=buffer_size) return;
+			LOG_NOTICE<<this<<" remapping pool from "<<buffer_size<<" to "<<n<<std::endl;
+			typename CELL::RAW_ALLOCATOR raw;
+			buffer=raw.allocate(n);
+			buffer_size=n;
+			if constexpr(CELL::SPLIT) CELL::reserve(n/cell_size);
+			#endif
+		}
+		//whole cells of the file up to the largest index: every process maps that much, see remap()
+		template<typename CELL> size_t shared_size() const{
+			return std::min<size_t>(raw_allocator_traits<typename CELL::RAW_ALLOCATOR>::file_size()/cell_size,CELL::MAX_BUFFER_SIZE)*cell_size;
 		}
 		template<typename CELL> CELL* get_cells(){
 			return (CELL*)buffer;
@@ -1045,38 +2125,1375 @@ namespace pool_allocator{
 		size_t size() const{return buffer_size/cell_size;}
 		template<typename CELL> void status(){
 			CELL *c=(CELL*)buffer;
-			LOG_DEBUG<<"pool "<<c[0].body.info.size<<"/"<<buffer_size/sizeof(CELL)<<" cell(s) "<<std::endl;
+			POOL_LOG_DEBUG<<"pool "<<c[0].body.info.size<<"/"<<buffer_size/sizeof(CELL)<<" cell(s) "<<std::endl;
+		}
+		//largest buffer the pool can ever need, 0 means no reservation
+		template<typename CELL> static size_t max_reserve(){
+			#ifdef POOL_ALLOCATOR_STABLE_MMAP
+			return std::min<size_t>(CELL::MAX_BUFFER_SIZE,POOL_ALLOCATOR_MAX_RESERVE/sizeof(CELL))*sizeof(CELL);
+			#else
+			return 0;
+			#endif
+		}
+		/*
+		*	replace the buffer with a bigger one, new cells are zeroed if the buffer is volatile
+		*/ 
+		template<typename CELL> void grow(size_t new_buffer_size){
+			LOG_NOTICE<<this<<" increasing pool size from "<<buffer_size<<" to "<<new_buffer_size<<std::endl;
+			//at this stage we may decide to increase the original buffer
+			//we need to create new buffer, copy in the old one
+			typename CELL::RAW_ALLOCATOR raw;
+			auto new_buffer=raw.allocate(new_buffer_size);
+			#ifdef POOL_ALLOCATOR_MULTI_PROCESS
+			//the file is rounded up to a page and the other processes map all of it: the callers put the extra cells on the free list
+			new_buffer_size=std::max(new_buffer_size,shared_size<CELL>());
+			#endif
+			//the next 3 stages must be avoided when dealing with mmap
+			if(!raw_allocator_traits<typename CELL::RAW_ALLOCATOR>::IN_PLACE){
+				memcpy(new_buffer,buffer,buffer_size);
+				memset(new_buffer+buffer_size,0,new_buffer_size-buffer_size);
+				raw.deallocate(buffer,buffer_size);	
+				counters::add(get_counters<CELL>().bytes_copied,buffer_size);
+			}else{
+				counters::add(get_counters<CELL>().remaps);
+			}
+			char* old=buffer;
+			buffer=new_buffer;
+			buffer_size=new_buffer_size;
+			set_base<CELL>(old);
+			counters::add(get_counters<CELL>().growths);
+			if(!raw_allocator_traits<typename CELL::RAW_ALLOCATOR>::VOLATILE) get_dirty_pages<CELL>().resize(buffer_size);
+			if(occupancy<CELL>::ENABLED) get_occupancy<CELL>().resize(buffer_size/cell_size);
+			if constexpr(CELL::SPLIT) CELL::reserve(buffer_size/cell_size);
+		}
+		/*
+		*	grow by at least n cells according to the growth policy, returns the number of cells added
+		*/ 
+		template<typename CELL> size_t expand(size_t n){
+			size_t old_size=buffer_size/cell_size;
+			LOG_NOTICE<<"new buffer size:"<<old_size+n<<" vs "<<(CELL::MAX_BUFFER_SIZE)<<std::endl;
+			if(old_size+n>CELL::MAX_BUFFER_SIZE) throw std::bad_alloc();
+			size_t k=std::min<size_t>(std::max<size_t>(growth_policy<typename CELL::PAYLOAD>::get(old_size,n),n),CELL::MAX_BUFFER_SIZE-old_size);
+			grow<CELL>(buffer_size+k*cell_size);
+			return buffer_size/cell_size-old_size;
+		}
+		//make sure at least n cells are free
+		template<typename CELL> void reserve(size_t n){
+			CELL *c=(CELL*)buffer;
+			size_t old_size=buffer_size/cell_size;
+			size_t available=old_size-1-c[0].body.info.size;
+			if(available>=n) return;
+			if(old_size+n-available>CELL::MAX_BUFFER_SIZE) throw std::bad_alloc();
+			typename journal<CELL>::transaction t(*this);
+			grow<CELL>(buffer_size+(n-available)*cell_size);
+			release<CELL>(old_size,buffer_size/cell_size-old_size);
+		}
+		//the cells beyond new_buffer_size must be free
+		template<typename CELL> void shrink(size_t new_buffer_size){
+			LOG_NOTICE<<this<<" decreasing pool size from "<<buffer_size<<" to "<<new_buffer_size<<std::endl;
+			counters::add(get_counters<CELL>().shrinks);
+			if(raw_allocator_traits<typename CELL::RAW_ALLOCATOR>::IN_PLACE){
+				size_t old_buffer_size=buffer_size;
+				//first, if we stop here the file is only too big
+				buffer_size=new_buffer_size;
+				//what is kept must look like new memory for the next grow()
+				if(!raw_allocator_traits<typename CELL::RAW_ALLOCATOR>::truncate(new_buffer_size))
+					memset(buffer+new_buffer_size,0,old_buffer_size-new_buffer_size);
+			}else{
+				typename CELL::RAW_ALLOCATOR raw;
+				auto new_buffer=raw.allocate(new_buffer_size);
+				memcpy(new_buffer,buffer,new_buffer_size);
+				raw.deallocate(buffer,buffer_size);
+				char* old=buffer;
+				buffer=new_buffer;
+				buffer_size=new_buffer_size;
+				set_base<CELL>(old);
+			}
+		}
+		/*
+		*	give back the free cells at the end of the buffer (whole pages), returns the number of bytes released.
+		*	Without OPTIM_POS adjacent free ranges are not merged, they are collected from the end
+		*/ 
+		template<typename CELL> size_t trim(){
+			typedef typename CELL::INDEX INDEX;
+			//other processes have it mapped
+			if(MULTI_PROCESS && !raw_allocator_traits<typename CELL::RAW_ALLOCATOR>::VOLATILE) return 0;
+			if(!writable) return 0;
+			size_t n=buffer_size/cell_size,new_n=0;
+			{
+				typename journal<CELL>::transaction t(*this);
+				CELL *c=(CELL*)buffer;
+				//the free ranges sorted by position, the tail is the run of adjacent ranges ending at n
+				std::vector<std::pair<size_t,size_t>> ranges;
+				for(INDEX i=c[0].body.info.next;i;i=c[i].body.info.next) ranges.push_back({i,c[i].body.info.size});
+				std::sort(ranges.begin(),ranges.end());
+				size_t start=n;
+				for(auto r=ranges.rbegin();r!=ranges.rend()&&r->first+r->second==start;++r) start=r->first;
+				//keep the rest of the page and the initial size
+				new_n=std::max<size_t>(std::max<size_t>((start*cell_size+dirty_pages::PAGE_SIZE-1)/dirty_pages::PAGE_SIZE*dirty_pages::PAGE_SIZE/cell_size,128),start);
+				if(new_n>=n) return 0;
+				get_bins<CELL>().ready=false;
+				//ranges do not overlap: every range at or after start is in the tail
+				for(INDEX prev=0,i=c[0].body.info.next;i;){
+					INDEX next=c[i].body.info.next;
+					if(i>=start){
+						touch<CELL>(c,prev);
+						c[prev].body.info.next=next;
+					}else{
+						prev=i;
+					}
+					i=next;
+				}
+				if(new_n>start) release<CELL>(start,new_n-start);
+			}
+			//the journal must not roll the free list back over a shorter buffer
+			if(journal<CELL>::ENABLED && get_journal<CELL>().h) get_journal<CELL>().checkpoint(*this);
+			size_t released=(n-new_n)*cell_size;
+			shrink<CELL>(new_n*cell_size);
+			return released;
+		}
+		//process-local: number of free cells under which auto_trim() does not try again
+		template<typename CELL> static size_t& get_trim_mark(){
+			static size_t m=0;
+			return m;
+		}
+		template<typename CELL> void auto_trim(){
+			CELL *c=(CELL*)buffer;
+			size_t n=buffer_size/cell_size,available=n-1-c[0].body.info.size;
+			if(available*100<n*trim_threshold<typename CELL::PAYLOAD>::value) return;
+			auto& m=get_trim_mark<CELL>();
+			if(available<m) return;
+			//nothing at the end: wait for more cells to be freed
+			m=trim<CELL>() ? 0 : available+n/16+1;
+		}
+		/*
+		*	slide the live cells toward the front (keeping their order so multi-cell allocations stay contiguous),
+		*	the free cells become a single range at the end and the buffer is shrunk to the last page.
+		*	Returns the new index of every cell, 0 if it was free.
+		*	Offline: the pool must not be used meanwhile and the payloads must be relocatable, 
+		*	it is not journaled (take a snapshot first), the pool is synced at the end
+		*/ 
+		template<typename CELL> std::vector<typename CELL::INDEX> compact(){
+			typedef typename CELL::INDEX INDEX;
+			if(!writable) throw std::runtime_error("read-only pool");
+			//older records would be played against the new layout
+			if(journal<CELL>::ENABLED && get_journal<CELL>().h) get_journal<CELL>().checkpoint(*this);
+			CELL *c=(CELL*)buffer;
+			size_t n=buffer_size/cell_size;
+			//unmanaged cells are in use unless on the free list
+			std::vector<bool> free(n,false);
+			for(INDEX i=c[0].body.info.next;i;i=c[i].body.info.next)
+				std::fill(free.begin()+i,free.begin()+std::min<size_t>(i+c[i].body.info.size,n),true);
+			std::vector<INDEX> r(n,0);
+			size_t j=1;
+			for(size_t i=1;i<n;++i){
+				if(free[i]||!CELL::in_use(c,i)) continue;
+				if(i!=j){
+					memcpy((void*)(c+j),(void*)(c+i),sizeof(CELL));
+					if constexpr(CELL::SPLIT) CELL::move(i,j);
+				}
+				r[i]=j++;
+			}
+			if(c[0].body.info.size!=j-1) LOG_WARNING<<"pool reports "<<(size_t)c[0].body.info.size<<" cell(s) in use, found "<<j-1<<std::endl;
+			//keep the rest of the last page
+			size_t new_n=std::min(n,std::max(j,(j*cell_size+dirty_pages::PAGE_SIZE-1)/dirty_pages::PAGE_SIZE*dirty_pages::PAGE_SIZE/cell_size));
+			#ifdef POOL_ALLOCATOR_MULTI_PROCESS
+			//other processes have it mapped
+			new_n=n;
+			#endif
+			memset((void*)(c+j),0,(new_n-j)*cell_size);
+			if constexpr(CELL::SPLIT) CELL::post_deallocate(c,j,n-j);
+			c[0].body.info.size=j-1;
+			c[0].body.info.next=0;
+			if(new_n>j){
+				c[j].body.info.size=new_n-j;
+				c[j].body.info.next=0;
+				c[0].body.info.next=j;
+			}
+			get_bins<CELL>().ready=false;
+			get_occupancy<CELL>().ready=false;
+			if(new_n<n) shrink<CELL>(new_n*cell_size);
+			LOG_NOTICE<<this<<" compacted "<<j-1<<" cell(s) out of "<<n<<std::endl;
+			if(!raw_allocator_traits<typename CELL::RAW_ALLOCATOR>::VOLATILE){
+				mark_dirty<CELL>(0,buffer_size);
+				checkpoint<CELL>(true);
+			}
+			return r;
+		}
+		/*
+		*	rewrite the file of a persistent pool for a wider index: cell i stays cell i so the pointers to 
+		*	the pool keep their value, but ptr members of the payload are copied as they are: a ptr to OLD_CELL
+		*	is dangling afterwards (see allocator::migrate_from()). Must be called 
+		*	before the pool is loaded, the new cell type then registers a new pool that maps the migrated file,
+		*	see allocator::migrate_from(). Returns the number of cells
+		*/ 
+		template<typename OLD_CELL,typename NEW_CELL> static size_t migrate_index(const std::string& file_name){
+			typedef typename NEW_CELL::PAYLOAD PAYLOAD;
+			static_assert(std::is_same<typename OLD_CELL::PAYLOAD,PAYLOAD>::value,"same payload");
+			static_assert((bool)OLD_CELL::MANAGED==(bool)NEW_CELL::MANAGED,"same management");
+			static_assert(sizeof(typename NEW_CELL::INDEX)>=sizeof(typename OLD_CELL::INDEX),"the index can only be widened");
+			//several payloads per cell: the payload indices would change
+			static_assert(OLD_CELL::FACTOR==1&&NEW_CELL::FACTOR==1,"payload smaller than the free list info");
+			static_assert(!OLD_CELL::SPLIT&&!NEW_CELL::SPLIT,"the management of split cells is in another file");
+			enum{PAGE_SIZE=4096};
+			int fd=open(file_name.c_str(),O_RDONLY);
+			if(fd==-1) throw std::runtime_error("could not open `"+file_name+"'");
+			struct stat st;
+			if(fstat(fd,&st)==-1||st.st_size<(off_t)sizeof(OLD_CELL)){
+				close(fd);
+				return 0;
+			}
+			size_t n=st.st_size/sizeof(OLD_CELL);
+			void* v=mmap(nullptr,st.st_size,PROT_READ,MAP_PRIVATE,fd,0);
+			close(fd);
+			if(v==MAP_FAILED) throw std::runtime_error("could not map `"+file_name+"'");
+			const OLD_CELL* o=(const OLD_CELL*)v;
+			/*
+			*	the cells past the old pool's buffer_size are neither allocated nor free (file rounded up 
+			*	to a page), they join the free list. With POOL_ALLOCATOR_MULTI_PROCESS the buffer is the whole file
+			*	up to the largest index
+			*/
+			std::hash<std::string> str_hash;
+			size_t old_type_id=str_hash(typeid(OLD_CELL).name());
+			POOL_ALLOCATOR pools;
+			auto entry=std::find_if(pools.cbegin(),pools.cend(),[=](const pool& p){return p.type_id==old_type_id;});
+			size_t old_n=std::min<size_t>(n,OLD_CELL::MAX_BUFFER_SIZE);
+			#ifndef POOL_ALLOCATOR_MULTI_PROCESS
+			if(entry!=pools.cend()) old_n=std::max<size_t>(std::min<size_t>(old_n,(*entry).buffer_size/sizeof(OLD_CELL)),1);
+			#endif
+			std::vector<bool> free_cell(n,false);
+			for(size_t i=old_n;i<n;++i) free_cell[i]=true;
+			std::vector<size_t> heads;
+			for(size_t i=o[0].body.info.next;i&&i<old_n;i=o[i].body.info.next){
+				heads.push_back(i);
+				for(size_t j=i;j<std::min<size_t>(i+o[i].body.info.size,n);++j) free_cell[j]=true;
+			}
+			size_t new_buffer_size=(n*sizeof(NEW_CELL)+PAGE_SIZE-1)/PAGE_SIZE*PAGE_SIZE;
+			std::string tmp=file_name+".migrate";
+			int out=open(tmp.c_str(),O_RDWR|O_CREAT|O_TRUNC,(mode_t)0600);
+			if(out==-1||ftruncate(out,new_buffer_size)==-1){
+				munmap(v,st.st_size);
+				if(out!=-1) close(out);
+				throw std::runtime_error("could not create `"+tmp+"'");
+			}
+			NEW_CELL* c=(NEW_CELL*)mmap(nullptr,new_buffer_size,PROT_READ|PROT_WRITE,MAP_SHARED,out,0);
+			close(out);
+			if(c==MAP_FAILED){
+				munmap(v,st.st_size);
+				throw std::runtime_error("could not map `"+tmp+"'");
+			}
+			//the new file is zero-filled
+			c[0].body.info.size=o[0].body.info.size;
+			c[0].body.info.next=o[0].body.info.next;
+			for(size_t i=1;i<n;++i){
+				if(free_cell[i]) continue;
+				if constexpr(NEW_CELL::MANAGED) c[i].management=o[i].management;
+				memcpy((void*)&c[i].body.payload,(const void*)&o[i].body.payload,sizeof(PAYLOAD));
+			}
+			for(auto i:heads){
+				c[i].body.info.size=o[i].body.info.size;
+				c[i].body.info.next=o[i].body.info.next;
+			}
+			//[old_n,m) with the cells gained by rounding up to a page go at the end of the free list, it stays ordered
+			size_t m=new_buffer_size/sizeof(NEW_CELL);
+			if(m>old_n){
+				if(!heads.empty()&&heads.back()+o[heads.back()].body.info.size==old_n){
+					c[heads.back()].body.info.size=m-heads.back();
+				}else{
+					c[old_n].body.info.size=m-old_n;
+					c[old_n].body.info.next=0;
+					c[heads.empty() ? 0 : heads.back()].body.info.next=old_n;
+				}
+			}
+			msync(c,new_buffer_size,MS_SYNC);
+			munmap(c,new_buffer_size);
+			munmap(v,st.st_size);
+			if(rename(tmp.c_str(),file_name.c_str())==-1) throw std::runtime_error("could not replace `"+file_name+"'");
+			//the old cell type must not find its pool struct with the new layout
+			if(entry!=pools.cend()) pools.deallocate(POOL_PTR(entry),1);
+			LOG_NOTICE<<"migrated "<<n<<" cell(s) of `"<<file_name<<"' from "<<sizeof(typename OLD_CELL::INDEX)<<"-byte to "<<sizeof(typename NEW_CELL::INDEX)<<"-byte index"<<std::endl;
+			return n;
+		}
+		/*
+		*	size classes for segregated fit, class k holds ranges of size [2^k,2^(k+1))
+		*	head/tail are process-local, they are rebuilt from the free list the first time the pool is used
+		*/ 
+		template<typename CELL> struct bins{
+			typedef typename CELL::INDEX INDEX;
+			enum{N=sizeof(INDEX)<<3};
+			INDEX head[N];
+			INDEX tail[N];
+			uint64_t map=0;//bit k set if class k not empty
+			bool ready=false;
+			size_t released=0;//ranges pushed back since the last coalesce()
+			static int floor_log2(size_t s){return 63-__builtin_clzll(s);}
+			static int ceil_log2(size_t s){return s==1 ? 0 : floor_log2(s-1)+1;}
+			//tail of the closest non-empty class below k, or cell 0
+			INDEX pred(int k) const{
+				uint64_t m=map&((1ULL<<k)-1);
+				return m ? tail[floor_log2(m)] : 0;
+			}
+			void push(CELL* c,INDEX i,size_t size){
+				int k=floor_log2(size);
+				INDEX p=pred(k);
+				touch<CELL>(c,i);
+				touch<CELL>(c,p);
+				c[i].body.info.size=size;
+				c[i].body.info.next=c[p].body.info.next;
+				c[p].body.info.next=i;
+				if(!(map&(1ULL<<k))){
+					tail[k]=i;
+					map|=1ULL<<k;
+				}
+				head[k]=i;
+			}
+			//remove i from class k, prev is the previous range in the list
+			void remove(CELL* c,INDEX prev,INDEX i,int k){
+				if(i==head[k]){
+					touch<CELL>(c,pred(k));
+					c[pred(k)].body.info.next=c[i].body.info.next;
+					if(tail[k]==i)
+						map&=~(1ULL<<k);
+					else
+						head[k]=c[i].body.info.next;
+				}else{
+					touch<CELL>(c,prev);
+					c[prev].body.info.next=c[i].body.info.next;
+					if(tail[k]==i) tail[k]=prev;
+				}
+			}
+			//find and unlink a range of at least n cells, merge the free neighbours if none, 0 if still none
+			INDEX pop(CELL* c,size_t n){
+				INDEX i=find(c,n);
+				if(!i&&released&&coalesce(c)) i=find(c,n);
+				return i;
+			}
+			INDEX find(CELL* c,size_t n){
+				int k=ceil_log2(n);
+				uint64_t m=k<N ? map&(~0ULL<<k) : 0;
+				if(m){//any range in those classes will do
+					k=__builtin_ctzll(m);
+					INDEX i=head[k];
+					remove(c,0,i,k);
+					return i;
+				}
+				k=floor_log2(n);
+				if(map&(1ULL<<k)){//some ranges in that class might be big enough
+					INDEX prev=head[k];
+					if(c[prev].body.info.size>=n){
+						remove(c,0,prev,k);
+						return prev;
+					}
+					while(prev!=tail[k]){
+						INDEX i=c[prev].body.info.next;
+						if(c[i].body.info.size>=n){
+							remove(c,prev,i,k);
+							return i;
+						}
+						prev=i;
+					}
+				}
+				return 0;
+			}
+			//dispatch the free list, adjacent ranges are merged if merge is set, returns the number of ranges
+			size_t load(CELL* c,bool merge=false){
+				std::vector<std::pair<INDEX,size_t>> ranges;
+				for(INDEX i=c[0].body.info.next;i;i=c[i].body.info.next) ranges.push_back({i,c[i].body.info.size});
+				if(merge){
+					std::sort(ranges.begin(),ranges.end());
+					size_t j=0;
+					for(size_t i=1;i<ranges.size();++i){
+						if(ranges[j].first+ranges[j].second==ranges[i].first)
+							ranges[j].second+=ranges[i].second;
+						else
+							ranges[++j]=ranges[i];
+					}
+					if(!ranges.empty()) ranges.resize(j+1);
+				}
+				touch<CELL>(c,0);
+				c[0].body.info.next=0;
+				map=0;
+				for(auto& r:ranges) push(c,r.first,r.second);
+				ready=true;
+				released=0;
+				return ranges.size();
+			}
+			//merge the adjacent free ranges, one pass over the free list, true if any
+			bool coalesce(CELL* c){
+				size_t before=0;
+				for(INDEX i=c[0].body.info.next;i;i=c[i].body.info.next) ++before;
+				return load(c,true)<before;
+			}
+		};
+		template<typename CELL> static bins<CELL>& get_bins(){
+			static bins<CELL> b;
+			return b;
+		}
+		/*
+		*	bit i set if cell i is allocated, built from the management the first time the pool is
+		*	iterated then kept up to date by post_allocate()/post_deallocate()
+		*/ 
+		template<typename CELL> struct occupancy{
+			enum{ENABLED=CELL::MANAGED&&occupancy_index<typename CELL::PAYLOAD>::value&&!MULTI_PROCESS};
+			std::vector<uint64_t> map;
+			bool ready=false;
+			//called when the buffer grows so mark() does not have to reallocate
+			void resize(size_t n){
+				if(ready&&(n+63)/64>map.size()) map.resize((n+63)/64);
+			}
+			void mark(size_t i,size_t n,bool allocated){
+				if(!ready) return;
+				if((i+n+63)/64>map.size()) map.resize((i+n+63)/64);
+				for(size_t k=i;k<i+n;){
+					size_t b=k%64,m=std::min<size_t>(64-b,i+n-k);
+					uint64_t bits=(m==64 ? ~0ULL : ((1ULL<<m)-1))<<b;
+					if(allocated)
+						__atomic_fetch_or(&map[k/64],bits,__ATOMIC_RELAXED);
+					else
+						__atomic_fetch_and(&map[k/64],~bits,__ATOMIC_RELAXED);
+					k+=m;
+				}
+			}
+			void load(const CELL* c,size_t n){
+				map.assign((n+63)/64,0);
+				for(size_t i=1;i<n;++i) if(CELL::in_use(c,i)) map[i/64]|=1ULL<<(i%64);
+				ready=true;
+				POOL_LOG_DEBUG<<"occupancy of "<<n<<" cell(s) loaded"<<std::endl;
+			}
+			//first allocated cell at or after i, assumes there is one
+			size_t next(size_t i) const{
+				size_t w=i/64;
+				uint64_t bits=map[w]&(~0ULL<<(i%64));
+				while(!bits) bits=map[++w];
+				return w*64+__builtin_ctzll(bits);
+			}
+			//first allocated cell in [i,e), e if none
+			size_t next(size_t i,size_t e) const{
+				if(i>=e) return e;
+				size_t w=i/64,last=std::min((e+63)/64,map.size());
+				if(w>=last) return e;
+				uint64_t bits=map[w]&(~0ULL<<(i%64));
+				while(!bits&&++w<last) bits=map[w];
+				return bits ? std::min(w*64+__builtin_ctzll(bits),e) : e;
+			}
+		};
+		template<typename CELL> static occupancy<CELL>& get_occupancy(){
+			static occupancy<CELL> o;
+			return o;
+		}
+		//first allocated cell at or after i
+		template<typename CELL> static size_t next_allocated(const CELL* c,size_t i,size_t n){
+			if(occupancy<CELL>::ENABLED){
+				auto& o=get_occupancy<CELL>();
+				if(!o.ready) o.load(c,n);
+				return o.next(i);
+			}
+			while(!CELL::in_use(c,i)) ++i;
+			return i;
+		}
+		/*
+		*	activity of a pool in this process, relaxed atomic increments so they can be left on.
+		*	Only the pool operations are seen: a batch counts as one, the magazines only when they
+		*	are refilled or flushed
+		*/ 
+		struct counters{
+			uint64_t allocations=0;
+			uint64_t deallocations=0;
+			uint64_t cells_allocated=0;
+			uint64_t cells_deallocated=0;
+			uint64_t free_list_steps=0;//ranges visited by first fit and ordered release
+			uint64_t lock_free=0;//single cells served or taken back by the free stack
+			uint64_t growths=0;
+			uint64_t shrinks=0;
+			uint64_t bytes_copied=0;//by the growths of buffers that can not be extended in place
+			uint64_t remaps=0;//growths extending the mapping of the file
+			//latency[k]: calls that took [2^k,2^(k+1)) ns, only with POOL_ALLOCATOR_LATENCY
+			struct latency{
+				enum{N=40};
+				uint64_t h[N]={};
+				void add(uint64_t ns){counters::add(h[std::min<int>(63-__builtin_clzll(ns|1),N-1)]);}
+				struct timer{
+					latency& l;
+					std::chrono::steady_clock::time_point start=std::chrono::steady_clock::now();
+					~timer(){l.add(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now()-start).count());}
+				};
+			};
+			latency allocate_latency;
+			latency deallocate_latency;
+			static void add(uint64_t& c,uint64_t n=1){__atomic_fetch_add(&c,n,__ATOMIC_RELAXED);}
+			static void sub(uint64_t& c,uint64_t n=1){__atomic_fetch_sub(&c,n,__ATOMIC_RELAXED);}
+			void allocated(size_t n){
+				add(allocations);
+				add(cells_allocated,n);
+			}
+			void deallocated(size_t n){
+				add(deallocations);
+				add(cells_deallocated,n);
+			}
+		};
+		template<typename CELL> static counters& get_counters(){
+			static counters c;
+			return c;
+		}
+		/*
+		*	state of a pool for capacity planning: one walk of the free list, cheap enough for production.
+		*	Cells held by the free stack or the magazines count as live, call allocator::flush() first
+		*/ 
+		struct stats{
+			size_t type_id=0;
+			size_t cell_size=0;
+			size_t capacity=0;//cells, the header excluded
+			size_t live=0;
+			size_t free_cells=0;
+			size_t free_ranges=0;
+			size_t largest_free=0;
+			//free_histogram[k]: free ranges of [2^k,2^(k+1)) cells
+			uint64_t free_histogram[64]={};
+			counters activity;
+			static void histogram_to_json(std::ostream& os,const uint64_t* h,size_t n){
+				while(n&&!h[n-1]) --n;
+				os<<"[";
+				for(size_t k=0;k<n;++k) os<<(k ? "," : "")<<h[k];
+				os<<"]";
+			}
+			void to_json(std::ostream& os) const{
+				os<<"{\"type_id\":\""<<std::hex<<type_id<<std::dec<<"\",\"cell_size\":"<<cell_size
+					<<",\"capacity\":"<<capacity<<",\"live\":"<<live<<",\"free_cells\":"<<free_cells
+					<<",\"free_ranges\":"<<free_ranges<<",\"largest_free\":"<<largest_free<<",\"free_histogram\":";
+				histogram_to_json(os,free_histogram,64);
+				os<<",\"allocations\":"<<activity.allocations<<",\"deallocations\":"<<activity.deallocations
+					<<",\"cells_allocated\":"<<activity.cells_allocated<<",\"cells_deallocated\":"<<activity.cells_deallocated
+					<<",\"free_list_steps\":"<<activity.free_list_steps<<",\"lock_free\":"<<activity.lock_free
+					<<",\"growths\":"<<activity.growths<<",\"shrinks\":"<<activity.shrinks
+					<<",\"bytes_copied\":"<<activity.bytes_copied<<",\"remaps\":"<<activity.remaps<<",\"allocate_latency_ns\":";
+				histogram_to_json(os,activity.allocate_latency.h,counters::latency::N);
+				os<<",\"deallocate_latency_ns\":";
+				histogram_to_json(os,activity.deallocate_latency.h,counters::latency::N);
+				os<<"}";
+			}
+			static void to_json(std::ostream& os,const std::vector<stats>& v){
+				os<<"[";
+				for(size_t i=0;i<v.size();++i){
+					if(i) os<<",";
+					v[i].to_json(os);
+				}
+				os<<"]";
+			}
+		};
+		template<typename CELL> stats get_stats(){
+			CELL* c=get_cells<CELL>();
+			stats s;
+			s.type_id=type_id;
+			s.cell_size=cell_size;
+			s.capacity=size()-1;
+			s.live=c[0].body.info.size;
+			for(size_t i=c[0].body.info.next;i;i=c[i].body.info.next){
+				size_t n=c[i].body.info.size;
+				++s.free_ranges;
+				s.free_cells+=n;
+				s.largest_free=std::max(s.largest_free,n);
+				++s.free_histogram[63-__builtin_clzll(n|1)];
+			}
+			s.activity=get_counters<CELL>();
+			return s;
+		}
+		/*
+		*	every pool loaded by this process registers its allocator's stats
+		*/ 
+		typedef stats (*stats_f)();
+		struct stats_functions{
+			std::mutex m;
+			std::vector<stats_f> v;
+		};
+		static stats_functions& get_stats_functions(){
+			static stats_functions s;
+			return s;
+		}
+		static void register_stats(stats_f f){
+			auto& s=get_stats_functions();
+			std::lock_guard<std::mutex> l(s.m);
+			s.v.push_back(f);
+		}
+		//the pool of pools then the pools loaded by this process, see stats::to_json()
+		static std::vector<stats> stats_all(){
+			std::vector<stats> v{get_pool<POOL_CELL>()->get_stats<POOL_CELL>()};
+			auto& s=get_stats_functions();
+			std::lock_guard<std::mutex> l(s.m);
+			for(auto f:s.v) v.push_back(f());
+			return v;
+		}
+		template<typename CELL> static void post_allocate(CELL* c,size_t i,size_t n){
+			CELL::post_allocate(c,i,n);
+			if(occupancy<CELL>::ENABLED) get_occupancy<CELL>().mark(i,n,true);
+		}
+		template<typename CELL> static void post_deallocate(CELL* c,size_t i,size_t n){
+			CELL::post_deallocate(c,i,n);
+			if(occupancy<CELL>::ENABLED) get_occupancy<CELL>().mark(i,n,false);
+		}
+		#ifdef POOL_ALLOCATOR_THREAD_SAFE
+		/*
+		*	lock-free stack of single cells recycled by the allocator, the link is stored in body.info.next
+		*	and the top is tagged to avoid ABA. Cells on the stack are free (c[0].body.info.size and 
+		*	management are up to date) but not on the free list.
+		*	Any other operation locks the stack: it waits until the operations in progress are done
+		*	and in the meantime new single cell operations fall back to the mutex, so the buffer can 
+		*	be moved safely.
+		*/ 
+		template<typename CELL> struct free_stack{
+			typedef typename CELL::INDEX INDEX;
+			enum{ENABLED=sizeof(INDEX)<=4};//index and tag must fit in 64 bits
+			std::atomic<uint64_t> top{0};//tag<<32|index
+			std::atomic<size_t> active{0};
+			std::atomic<bool> exclusive{false};
+			/*
+			*	the pool is created first so it is destroyed last: the destructor still finds it mapped.
+			*	Not for the pool of pools, its stack is created while the pool of pools is
+			*/ 
+			free_stack(){
+				if constexpr(!std::is_same<typename CELL::PAYLOAD,pool>::value) get_pool<CELL>();
+			}
+			bool enter(){
+				if(!ENABLED||journal<CELL>::ENABLED||MULTI_PROCESS) return false;//journaled and shared pools go through the mutex
+				active.fetch_add(1);
+				if(exclusive.load()){
+					active.fetch_sub(1);
+					return false;
+				}
+				return true;
+			}
+			void leave(){active.fetch_sub(1);}
+			void lock(){
+				if(!ENABLED) return;
+				exclusive.store(true);
+				while(active.load()) std::this_thread::yield();
+			}
+			void unlock(){exclusive.store(false);}
+			INDEX pop(pool& p){
+				CELL* c=p.get_cells<CELL>();
+				uint64_t t=top.load();
+				while(INDEX i=(INDEX)t){
+					//might read garbage if the cell has just been popped, the tag will tell
+					uint64_t next=(((t>>32)+1)<<32)|__atomic_load_n(&c[i].body.info.next,__ATOMIC_RELAXED);
+					if(top.compare_exchange_weak(t,next)){
+						__atomic_fetch_add(&c[0].body.info.size,1,__ATOMIC_RELAXED);
+						post_allocate<CELL>(c,i,1);
+						get_counters<CELL>().allocated(1);
+						counters::add(get_counters<CELL>().lock_free);
+						mark_dirty<CELL>(0,sizeof(CELL));
+						mark_dirty<CELL>(i*sizeof(CELL),sizeof(CELL));
+						return i;
+					}
+				}
+				return 0;
+			}
+			void push(pool& p,INDEX i){
+				CELL* c=p.get_cells<CELL>();
+				post_deallocate<CELL>(c,i,1);
+				get_counters<CELL>().deallocated(1);
+				counters::add(get_counters<CELL>().lock_free);
+				__atomic_fetch_sub(&c[0].body.info.size,1,__ATOMIC_RELAXED);
+				mark_dirty<CELL>(0,sizeof(CELL));
+				mark_dirty<CELL>(i*sizeof(CELL),sizeof(CELL));
+				uint64_t t=top.load();
+				do{
+					//read concurrently by pop()
+					__atomic_store_n(&c[i].body.info.next,(INDEX)t,__ATOMIC_RELAXED);
+				}while(!top.compare_exchange_weak(t,(((t>>32)+1)<<32)|i));
+			}
+			//must be locked
+			void flush(pool& p){
+				CELL* c=p.get_cells<CELL>();
+				uint64_t t=top.load();
+				for(INDEX i=(INDEX)t;i;){
+					INDEX next=c[i].body.info.next;
+					c[0].body.info.size+=1;//pool::deallocate will take it out
+					p.deallocate<CELL>(i,1);
+					i=next;
+					//already counted by push()
+					counters::sub(get_counters<CELL>().deallocations);
+					counters::sub(get_counters<CELL>().cells_deallocated);
+				}
+				top.store(((t>>32)+1)<<32);
+			}
+			//persistent pools: the cells must be back on the free list
+			~free_stack(){
+				if(ENABLED && (INDEX)top.load()) flush(*get_pool<CELL>());
+			}
+		};
+		template<typename CELL> static free_stack<CELL>& get_free_stack(){
+			static free_stack<CELL> s;
+			return s;
+		}
+		#endif
+		/*
+		*	undo journal of a persistent pool (db/<file>.journal): before a cell header or a range of 
+		*	management is modified its old value is appended, the records are dropped once the pool 
+		*	has been synced. If the process dies in between the records are played backward the next
+		*	time the pool is loaded.
+		*	Operations are bracketed by a transaction, nested ones (allocate calling itself, release...) 
+		*	only commit with the outermost.
+		*/ 
+		template<typename CELL> struct journal{
+			enum{MODE=journal_mode<typename CELL::PAYLOAD>::value};
+			enum{ENABLED=(int)MODE!=JOURNAL_NONE && !raw_allocator_traits<typename CELL::RAW_ALLOCATOR>::VOLATILE};
+			enum{HEADER,ALLOCATED,DEALLOCATED};
+			enum{PAGE_SIZE=4096};
+			struct record{
+				uint64_t index;
+				uint64_t n;
+				uint32_t kind;
+				typename CELL::INFO info;
+			};
+			struct header{
+				uint64_t count;//number of records
+				uint64_t ops;//operations since last sync
+			};
+			int fd=-1;
+			header* h=nullptr;
+			size_t file_size=0;
+			size_t depth=0;
+			journal(){
+				if(!ENABLED) return;
+				#ifdef POOL_ALLOCATOR_READ_ONLY
+				return;
+				#endif
+				auto name=raw_allocator_traits<typename CELL::RAW_ALLOCATOR>::file_name();
+				if(name.empty()) return;
+				name+=".journal";
+				fd=open(name.c_str(),O_RDWR|O_CREAT,(mode_t)0600);
+				if(fd==-1){
+					LOG_WARNING<<"could not open journal `"<<name<<"', pool not protected"<<std::endl;
+					return;
+				}
+				struct stat st;
+				fstat(fd,&st);
+				file_size=std::max<size_t>(st.st_size,16*PAGE_SIZE);
+				if(ftruncate(fd,file_size)==-1||(h=(header*)mmap(NULL,file_size,PROT_READ|PROT_WRITE,MAP_SHARED,fd,0))==MAP_FAILED){
+					LOG_WARNING<<"could not map journal `"<<name<<"', pool not protected"<<std::endl;
+					close(fd);
+					fd=-1;
+					h=nullptr;
+				}
+				LOG_NOTICE<<"journal `"<<name<<"' "<<(h ? h->count : 0)<<" record(s)"<<std::endl;
+			}
+			~journal(){
+				if(h) munmap(h,file_size);
+				if(fd!=-1) close(fd);
+			}
+			record* records(){return (record*)(h+1);}
+			static void sync(void* p,size_t n){
+				char* b=(char*)((uintptr_t)p&~(uintptr_t)(PAGE_SIZE-1));
+				msync(b,(char*)p+n-b,MS_SYNC);
+			}
+			void append(uint64_t index,uint64_t n,uint32_t kind,const typename CELL::INFO& info){
+				if(sizeof(header)+(h->count+1)*sizeof(record)>file_size){
+					size_t new_file_size=2*file_size;
+					if(ftruncate(fd,new_file_size)==-1) throw std::bad_alloc();
+					void* v=mremap(h,file_size,new_file_size,MREMAP_MAYMOVE);
+					if(v==MAP_FAILED) throw std::bad_alloc();
+					h=(header*)v;
+					file_size=new_file_size;
+				}
+				record& r=records()[h->count];
+				r.index=index;
+				r.n=n;
+				r.kind=kind;
+				r.info=info;
+				if((int)MODE==JOURNAL_PER_OP) sync(&r,sizeof(r));
+				++h->count;//the record is only valid once counted
+				if((int)MODE==JOURNAL_PER_OP) sync(h,sizeof(header));
+			}
+			//the pool is consistent: make the cells named by the records durable and forget the records
+			void checkpoint(pool& p){
+				char* buffer=p.buffer;
+				size_t buffer_size=p.buffer_size;
+				std::vector<size_t> pages;
+				for(size_t k=0;k<h->count;++k){
+					const record& r=records()[k];
+					size_t n=std::max<uint64_t>(r.n,1);
+					if constexpr(CELL::SPLIT) if(r.kind!=HEADER){
+						CELL::sync(r.index,n);
+						continue;
+					}
+					size_t begin=r.index*sizeof(CELL),end=std::min<size_t>((r.index+n)*sizeof(CELL),buffer_size);
+					for(size_t i=begin/PAGE_SIZE;i*PAGE_SIZE<end;++i) pages.push_back(i);
+				}
+				std::sort(pages.begin(),pages.end());
+				pages.erase(std::unique(pages.begin(),pages.end()),pages.end());
+				//one msync per run of consecutive pages
+				for(size_t i=0,j=0;i<pages.size();i=j){
+					for(j=i+1;j<pages.size()&&pages[j]==pages[j-1]+1;++j);
+					msync(buffer+pages[i]*PAGE_SIZE,std::min((pages[j-1]+1)*PAGE_SIZE,buffer_size)-pages[i]*PAGE_SIZE,MS_SYNC);
+				}
+				h->count=0;
+				h->ops=0;
+				sync(h,sizeof(header));
+			}
+			void begin(){++depth;}
+			void commit(pool& p){
+				if(--depth||!h||!h->count) return;
+				if((int)MODE==JOURNAL_PER_OP||++h->ops>=POOL_ALLOCATOR_JOURNAL_GROUP) checkpoint(p);
+			}
+			//called before the pool is used
+			void recover(CELL* c){
+				if(!h||!h->count) return;
+				LOG_WARNING<<"pool was not closed properly, rolling back "<<h->count<<" journal record(s)"<<std::endl;
+				size_t last=0;
+				for(size_t k=h->count;k>0;--k){
+					record& r=records()[k-1];
+					switch(r.kind){
+						case HEADER:c[r.index].body.info=r.info;break;
+						case ALLOCATED:post_deallocate<CELL>(c,r.index,r.n);break;
+						case DEALLOCATED:post_allocate<CELL>(c,r.index,r.n);break;
+					}
+					last=std::max<size_t>(last,r.index+r.n);
+				}
+				sync(c,(last+1)*sizeof(CELL));
+				if constexpr(CELL::SPLIT) CELL::checkpoint(true);
+				h->count=0;
+				h->ops=0;
+				sync(h,sizeof(header));
+			}
+			struct transaction{
+				pool& p;
+				transaction(pool& p):p(p){
+					if(!p.writable) throw std::runtime_error("read-only pool");
+					if(ENABLED) get_journal<CELL>().begin();
+				}
+				~transaction(){if(ENABLED) get_journal<CELL>().commit(p);}
+			};
+		};
+		template<typename CELL> static journal<CELL>& get_journal(){
+			static journal<CELL> j;
+			return j;
+		}
+		//save the header of cell i
+		template<typename CELL> static void touch(CELL* c,size_t i){
+			mark_dirty<CELL>(i*sizeof(CELL),sizeof(CELL));
+			if(!journal<CELL>::ENABLED) return;
+			auto& j=get_journal<CELL>();
+			if(j.h) j.append(i,0,journal<CELL>::HEADER,c[i].body.info);
+		}
+		//the management of [i,i+n) is about to change
+		template<typename CELL> static void touch(size_t i,size_t n,bool allocated){
+			if(!CELL::MANAGED) return;
+			mark_dirty<CELL>(i*sizeof(CELL),n*sizeof(CELL));
+			if(!journal<CELL>::ENABLED) return;
+			auto& j=get_journal<CELL>();
+			if(j.h) j.append(i,n,allocated ? journal<CELL>::ALLOCATED : journal<CELL>::DEALLOCATED,typename CELL::INFO());
+		}
+		#ifdef POOL_ALLOCATOR_MULTI_PROCESS
+		/*
+		*	robust process-shared mutex in db/<file>.lock, taken by the allocator with its own mutex.
+		*	If the owner dies the next process to lock it rolls back the journal.
+		*/ 
+		struct process_mutex{
+			int fd=-1;
+			pthread_mutex_t* m=nullptr;
+			process_mutex(std::string name){
+				if(name.empty()) return;
+				name+=".lock";
+				fd=open(name.c_str(),O_RDWR|O_CREAT,(mode_t)0600);
+				if(fd==-1){
+					//read-only database: nothing to protect
+					LOG_WARNING<<"could not open lock file `"<<name<<"', pool not locked"<<std::endl;
+					return;
+				}
+				//the first process initializes the mutex
+				flock(fd,LOCK_EX);
+				struct stat st;
+				fstat(fd,&st);
+				bool init=st.st_size<(off_t)sizeof(pthread_mutex_t);
+				if(init && ftruncate(fd,sizeof(pthread_mutex_t))==-1){
+					LOG_ERROR<<"Error calling ftruncate() on `"<<name<<"'"<<std::endl;
+					exit(EXIT_FAILURE);
+				}
+				m=(pthread_mutex_t*)mmap(NULL,sizeof(pthread_mutex_t),PROT_READ|PROT_WRITE,MAP_SHARED,fd,0);
+				if(m==MAP_FAILED){
+					LOG_ERROR<<"Error mmapping lock file `"<<name<<"'"<<std::endl;
+					exit(EXIT_FAILURE);
+				}
+				if(init){
+					pthread_mutexattr_t a;
+					pthread_mutexattr_init(&a);
+					pthread_mutexattr_setpshared(&a,PTHREAD_PROCESS_SHARED);
+					pthread_mutexattr_setrobust(&a,PTHREAD_MUTEX_ROBUST);
+					pthread_mutex_init(m,&a);
+					pthread_mutexattr_destroy(&a);
+				}
+				flock(fd,LOCK_UN);
+			}
+			//true if the previous owner died holding the mutex
+			bool lock(){
+				if(!m) return false;
+				if(pthread_mutex_lock(m)==EOWNERDEAD){
+					pthread_mutex_consistent(m);
+					return true;
+				}
+				return false;
+			}
+			void unlock(){if(m) pthread_mutex_unlock(m);}
+		};
+		struct scoped_flock{
+			int fd;
+			scoped_flock(int fd):fd(fd){if(fd!=-1) flock(fd,LOCK_EX);}
+			~scoped_flock(){if(fd!=-1) flock(fd,LOCK_UN);}
+		};
+		template<typename CELL> static process_mutex& get_process_mutex(){
+			typedef raw_allocator_traits<typename CELL::RAW_ALLOCATOR> TRAITS;
+			static process_mutex m(TRAITS::VOLATILE ? std::string() : TRAITS::file_name());
+			return m;
+		}
+		//then catch up with the other processes
+		template<typename CELL> static void lock_process(){
+			bool dead=get_process_mutex<CELL>().lock();
+			auto p=get_pool<CELL>();
+			p->template remap<CELL>();
+			if(dead){
+				if(journal<CELL>::ENABLED)
+					get_journal<CELL>().recover(p->template get_cells<CELL>());
+				else
+					LOG_WARNING<<"a process died while holding pool "<<typeid(CELL).name()<<", it might be corrupt (no journal)"<<std::endl;
+			}
+		}
+		template<typename CELL> static void unlock_process(){get_process_mutex<CELL>().unlock();}
+		#endif
+		/*
+		*	pages of a persistent buffer modified since the last checkpoint (process-local), 
+		*	so a checkpoint only msyncs what has changed.
+		*	Headers are marked by touch(), payloads by allocator::construct() and allocator::mark_dirty()
+		*/ 
+		struct dirty_pages{
+			enum{PAGE_SIZE=4096};
+			std::vector<uint64_t> map;
+			//called when the buffer grows so mark() does not have to reallocate
+			void resize(size_t buffer_size){
+				size_t n=(buffer_size+64*PAGE_SIZE-1)/(64*PAGE_SIZE);
+				if(n>map.size()) map.resize(n);
+			}
+			void mark(size_t offset,size_t n){
+				for(size_t k=offset/PAGE_SIZE;k<=(offset+n-1)/PAGE_SIZE;++k){
+					if(k/64>=map.size()) map.resize(k/64+1);
+					uint64_t bit=1ULL<<(k%64);
+					if(!(map[k/64]&bit)) __atomic_fetch_or(&map[k/64],bit,__ATOMIC_RELAXED);
+				}
+			}
+			/*
+			*	msync consecutive dirty pages in one call, returns the number of pages
+			*	only MS_SYNC clears the bits: MS_ASYNC may not write anything (it is a no-op on Linux)
+			*	so the pages stay dirty until a synchronous checkpoint, a failed msync marks them again
+			*/
+			size_t flush(char* buffer,size_t buffer_size,int flags){
+				size_t pages=(buffer_size+PAGE_SIZE-1)/PAGE_SIZE,count=0,start=0,end=0;
+				const bool clear=flags&MS_SYNC;
+				auto sync=[&](){
+					if(end>start && msync(buffer+start*PAGE_SIZE,std::min<size_t>((end-start)*PAGE_SIZE,buffer_size-start*PAGE_SIZE),flags)==-1){
+						LOG_ERROR<<"msync failed: "<<strerror(errno)<<std::endl;
+						if(clear) mark(start*PAGE_SIZE,(end-start)*PAGE_SIZE);
+					}
+				};
+				for(size_t w=0;w<map.size()&&w*64<pages;++w){
+					uint64_t bits=clear ? __atomic_exchange_n(&map[w],0,__ATOMIC_RELAXED) : __atomic_load_n(&map[w],__ATOMIC_RELAXED);
+					while(bits){
+						size_t k=w*64+__builtin_ctzll(bits);
+						bits&=bits-1;
+						if(k>=pages) break;
+						if(k!=end){
+							sync();
+							start=k;
+						}
+						end=k+1;
+						++count;
+					}
+				}
+				sync();
+				return count;
+			}
+		};
+		template<typename CELL> static dirty_pages& get_dirty_pages(){
+			static dirty_pages d;
+			return d;
+		}
+		//bytes [offset,offset+n) of the buffer have been modified
+		template<typename CELL> static void mark_dirty(size_t offset,size_t n){
+			if(raw_allocator_traits<typename CELL::RAW_ALLOCATOR>::VOLATILE) return;
+			get_dirty_pages<CELL>().mark(offset,n);
+		}
+		//write the dirty pages back to the file, MS_ASYNC only schedules the write
+		template<typename CELL> size_t checkpoint(bool sync){
+			if(raw_allocator_traits<typename CELL::RAW_ALLOCATOR>::VOLATILE||!writable) return 0;
+			size_t n=get_dirty_pages<CELL>().flush(buffer,buffer_size,sync ? MS_SYNC : MS_ASYNC);
+			if constexpr(CELL::SPLIT) CELL::checkpoint(sync);
+			//the pool is durable, the records of the current group can go
+			if(sync&&journal<CELL>::ENABLED){
+				auto& j=get_journal<CELL>();
+				if(j.h&&j.h->count&&!j.depth) j.checkpoint(*this);
+			}
+			POOL_LOG_DEBUG<<this<<" checkpoint "<<n<<" page(s)"<<std::endl;
+			return n;
+		}
+		/*
+		*	every persistent pool loaded by this process registers its allocator's checkpoint
+		*/ 
+		typedef size_t (*checkpoint_f)(bool);
+		struct checkpoints{
+			std::mutex m;
+			std::vector<checkpoint_f> v;
+		};
+		static checkpoints& get_checkpoints(){
+			static checkpoints c;
+			return c;
+		}
+		static void register_checkpoint(checkpoint_f f){
+			auto& c=get_checkpoints();
+			std::lock_guard<std::mutex> l(c.m);
+			c.v.push_back(f);
+		}
+		//all the persistent pools then the pool of pools, returns the number of pages
+		static size_t checkpoint_all(bool sync=false){
+			size_t n=0;
+			{
+				auto& c=get_checkpoints();
+				std::lock_guard<std::mutex> l(c.m);
+				for(auto f:c.v) n+=f(sync);
+			}
+			#ifndef NO_MMAP
+			#ifdef POOL_ALLOCATOR_THREAD_SAFE
+			POOL_ALLOCATOR::lock_guard lock;//the pool of pools grows when a pool is created
+			#endif
+			auto p=get_pool<POOL_CELL>();
+			if(p->writable){
+				//small enough to be written in full
+				msync(p->buffer,p->buffer_size,sync ? MS_SYNC : MS_ASYNC);
+				n+=(p->buffer_size+dirty_pages::PAGE_SIZE-1)/dirty_pages::PAGE_SIZE;
+			}
+			#endif
+			return n;
+		}
+		#ifdef POOL_ALLOCATOR_THREAD_SAFE
+		/*
+		*	background thread calling checkpoint_all(true) every `interval': the MS_SYNC writes happen off 
+		*	the allocating threads, each pool is locked while its dirty pages are scanned and written
+		*/ 
+		struct flusher{
+			std::mutex m;
+			std::condition_variable cv;
+			bool stop=false;
+			std::thread t;
+			flusher(std::chrono::milliseconds interval):t([this,interval](){
+				std::unique_lock<std::mutex> l(m);
+				while(!cv.wait_for(l,interval,[this](){return stop;})){
+					l.unlock();
+					checkpoint_all(true);
+					l.lock();
+				}
+			}){}
+			~flusher(){
+				{
+					std::lock_guard<std::mutex> l(m);
+					stop=true;
+				}
+				cv.notify_one();
+				t.join();
+				checkpoint_all(true);
+			}
+		};
+		static std::unique_ptr<flusher>& get_flusher(){
+			static std::unique_ptr<flusher> f;
+			return f;
+		}
+		static void start_flusher(std::chrono::milliseconds interval){
+			get_flusher().reset();
+			get_flusher().reset(new flusher(interval));
+		}
+		static void stop_flusher(){get_flusher().reset();}
+		#else
+		//the flusher reads the buffers and the dirty pages while the pools grow: the allocators must lock
+		template<typename T=void> static void start_flusher(std::chrono::milliseconds){
+			static_assert(!std::is_same<T,T>::value,"the flusher needs POOL_ALLOCATOR_THREAD_SAFE");
+		}
+		template<typename T=void> static void stop_flusher(){
+			static_assert(!std::is_same<T,T>::value,"the flusher needs POOL_ALLOCATOR_THREAD_SAFE");
+		}
+		#endif
+		/*
+		*	run of payloads at a fixed stride, random access, a plain array (data()) when the stride is
+		*	the size of the payload (unmanaged pools with OPTIMIZATION); index is the pointer index of
+		*	the first payload. Only valid until the pool grows
+		*/ 
+		template<typename T> struct strided_span{
+			char* base;
+			size_t stride;
+			size_t count;
+			size_t index;
+			typedef T value_type;
+			struct iterator{
+				typedef T value_type;
+				typedef T& reference;
+				typedef T* pointer;
+				typedef ptrdiff_t difference_type;
+				typedef std::random_access_iterator_tag iterator_category;
+				char* p;
+				size_t stride;
+				reference operator*() const{return *(T*)p;}
+				pointer operator->() const{return (T*)p;}
+				reference operator[](difference_type n) const{return *(T*)(p+n*(ptrdiff_t)stride);}
+				iterator& operator++(){p+=stride;return *this;}
+				iterator operator++(int){iterator tmp=*this;p+=stride;return tmp;}
+				iterator& operator--(){p-=stride;return *this;}
+				iterator operator--(int){iterator tmp=*this;p-=stride;return tmp;}
+				iterator& operator+=(difference_type n){p+=n*(ptrdiff_t)stride;return *this;}
+				iterator& operator-=(difference_type n){p-=n*(ptrdiff_t)stride;return *this;}
+				iterator operator+(difference_type n) const{return iterator{p+n*(ptrdiff_t)stride,stride};}
+				friend iterator operator+(difference_type n,const iterator& a){return a+n;}
+				iterator operator-(difference_type n) const{return iterator{p-n*(ptrdiff_t)stride,stride};}
+				difference_type operator-(const iterator& a) const{return (p-a.p)/(ptrdiff_t)stride;}
+				bool operator==(const iterator& a) const{return p==a.p;}
+				bool operator!=(const iterator& a) const{return p!=a.p;}
+				bool operator<(const iterator& a) const{return p<a.p;}
+				bool operator>(const iterator& a) const{return p>a.p;}
+				bool operator<=(const iterator& a) const{return p<=a.p;}
+				bool operator>=(const iterator& a) const{return p>=a.p;}
+			};
+			size_t size() const{return count;}
+			bool contiguous() const{return stride==sizeof(T);}
+			T* data() const{return (T*)base;}
+			T& operator[](size_t i) const{return *(T*)(base+i*stride);}
+			iterator begin() const{return iterator{base,stride};}
+			iterator end() const{return iterator{base+count*stride,stride};}
+		};
+		/*
+		*	runs of consecutive allocated cells: from the management (or the occupancy bitmap) of managed pools,
+		*	from the complement of the free list otherwise; cells held by the free stack or the magazines
+		*	count as allocated, call allocator::flush() first.
+		*	With several payloads per cell (unmanaged, CELL::FACTOR>1) a run covers every slot of its cells:
+		*	the pool does not know how many were asked for, so the slots left over by allocate(n) with n not 
+		*	a multiple of CELL::FACTOR (allocate(1) included) are part of the spans with unspecified values
+		*/ 
+		template<typename CELL> std::vector<strided_span<typename CELL::PAYLOAD>> spans(){
+			typedef typename CELL::PAYLOAD PAYLOAD;
+			CELL* c=get_cells<CELL>();
+			size_t n=size();
+			std::vector<std::pair<size_t,size_t>> runs;//[first,last) cells
+			if(CELL::MANAGED){
+				for(size_t i=next_live<CELL>(c,1,n);i<n;){
+					size_t j=i+1;
+					while(j<n&&CELL::in_use(c,j)) ++j;
+					runs.push_back({i,j});
+					i=next_live<CELL>(c,j,n);
+				}
+			}else{
+				std::vector<std::pair<size_t,size_t>> free_ranges;
+				for(size_t i=c[0].body.info.next;i;i=c[i].body.info.next) free_ranges.push_back({i,i+c[i].body.info.size});
+				std::sort(free_ranges.begin(),free_ranges.end());
+				size_t i=1;
+				for(auto& r:free_ranges){
+					if(r.first>i) runs.push_back({i,r.first});
+					i=std::max(i,r.second);
+				}
+				if(i<n) runs.push_back({i,n});
+			}
+			std::vector<strided_span<PAYLOAD>> v;
+			for(auto& r:runs){
+				size_t first=r.first*CELL::FACTOR;
+				v.push_back({buffer+first*stride+payload_offset,stride,(r.second-r.first)*CELL::FACTOR,first});
+			}
+			return v;
+		}
+		//first cell in [i,e) in use, e if none
+		template<typename CELL> static size_t next_live(const CELL* c,size_t i,size_t e){
+			if(occupancy<CELL>::ENABLED){
+				auto& o=get_occupancy<CELL>();
+				if(!o.ready) o.load(c,e);
+				return o.next(i,e);
+			}
+			while(i<e&&!CELL::in_use(c,i)) ++i;
+			return i;
+		}
+		/*
+		*	frozen view of a pool for readers (analytics, backups...) while the writers keep going.
+		*	The file is cloned next to the original (FICLONE shares the extents until either copy is written,
+		*	copy_file_range might do the same), the clone is unlinked and mapped MAP_PRIVATE.
+		*	Mapping the pool file itself MAP_PRIVATE would not do: the pages not written yet keep following the file.
+		*	Volatile pools and file systems that can not clone are copied to anonymous memory.
+		*	Must be created with the pool locked, see allocator::snapshot()
+		*/
+		template<typename CELL> struct snapshot{
+			static_assert(!CELL::SPLIT,"the management of split cells is not in the snapshot");
+			typedef typename CELL::INDEX INDEX;
+			typedef typename CELL::PAYLOAD PAYLOAD;
+			const CELL* c=nullptr;
+			size_t buffer_size=0;
+			//same as cell_iterator
+			class iterator{
+				const CELL* c;
+				INDEX index;
+				INDEX cell_index;
+				void skip(){
+					if(index<c[0].body.info.size){
+						while(!c[cell_index].management) ++cell_index;
+					}
+				}
+			public:
+				typedef PAYLOAD value_type;
+				typedef const PAYLOAD& reference;
+				typedef const PAYLOAD* pointer;
+				typedef ptrdiff_t difference_type;
+				typedef std::forward_iterator_tag iterator_category;
+				iterator(const CELL* c,INDEX index):c(c),index(index),cell_index(1){skip();}
+				iterator& operator++(){
+					++index;
+					++cell_index;
+					skip();
+					return *this;
+				}
+				pointer operator->() const{return &c[cell_index].body.payload;}
+				reference operator*() const{return c[cell_index].body.payload;}
+				bool operator==(const iterator& a)const{return index==a.index;}
+				bool operator!=(const iterator& a)const{return index!=a.index;}
+				INDEX get_cell_index() const{return cell_index;}
+			};
+			snapshot(pool& p):buffer_size(p.buffer_size){
+				char* v=(char*)MAP_FAILED;
+				auto name=raw_allocator_traits<typename CELL::RAW_ALLOCATOR>::file_name();
+				if(!raw_allocator_traits<typename CELL::RAW_ALLOCATOR>::VOLATILE && !name.empty()){
+					int src=open(name.c_str(),O_RDONLY);
+					std::string tmp=name+".snapshot.XXXXXX";
+					int fd=src==-1 ? -1 : mkstemp(&tmp[0]);
+					if(fd!=-1){
+						unlink(tmp.c_str());//lives as long as the mapping
+						if(clone(src,fd,buffer_size)) v=(char*)mmap(NULL,buffer_size,PROT_READ,MAP_PRIVATE,fd,0);
+						close(fd);
+					}
+					if(src!=-1) close(src);
+				}
+				if(v==MAP_FAILED){
+					LOG_NOTICE<<"copying pool to memory for snapshot"<<std::endl;
+					v=(char*)mmap(NULL,buffer_size,PROT_READ|PROT_WRITE,MAP_PRIVATE|MAP_ANONYMOUS,-1,0);
+					if(v==MAP_FAILED) throw std::bad_alloc();
+					memcpy(v,p.template get_cells<CELL>(),buffer_size);
+				}
+				c=(const CELL*)v;
+				POOL_LOG_DEBUG<<"snapshot of "<<typeid(CELL).name()<<" at "<<(void*)c<<" size:"<<buffer_size<<std::endl;
+			}
+			//true if the clone holds the first n bytes of src
+			static bool clone(int src,int fd,size_t n){
+				#ifdef FICLONE
+				if(ioctl(fd,FICLONE,src)==0) return true;
+				#endif
+				for(size_t done=0;done<n;){
+					ssize_t r=copy_file_range(src,NULL,fd,NULL,n-done,0);
+					if(r<=0) return false;
+					done+=r;
+				}
+				return true;
+			}
+			snapshot(const snapshot&)=delete;
+			snapshot& operator=(const snapshot&)=delete;
+			snapshot(snapshot&& s):c(s.c),buffer_size(s.buffer_size){s.c=nullptr;}
+			~snapshot(){if(c) munmap((void*)c,buffer_size);}
+			size_t size() const{return c[0].body.info.size;}
+			iterator begin() const{return iterator(c,0);}
+			iterator end() const{return iterator(c,size());}
+			//same index as the pool's pointers
+			const PAYLOAD& operator[](INDEX i) const{return c[i].body.payload;}
+		};
+		template<typename CELL> typename CELL::INDEX allocate_segregated(size_t n){
+			typename journal<CELL>::transaction t(*this);
+			CELL *c=(CELL*)buffer;
+			typedef typename CELL::INDEX INDEX;
+			auto& b=get_bins<CELL>();
+			if(!b.ready) b.load(c);
+			INDEX current=b.pop(c,n);
+			if(!current){
+				current=buffer_size/cell_size;
+				size_t k=expand<CELL>(n);
+				c=(CELL*)buffer;
+				touch<CELL>(c,current);
+				c[current].body.info.size=k;
+			}
+			if(c[current].body.info.size>n) b.push(c,current+n,c[current].body.info.size-n);
+			touch<CELL>(c,current);
+			touch<CELL>(c,0);
+			touch<CELL>(current,n,true);
+			c[current].body.info.size=0;
+			c[current].body.info.next=0;
+			c[0].body.info.size+=n;
+			post_allocate<CELL>(c,current,n);
+			get_counters<CELL>().allocated(n);
+			POOL_LOG_DEBUG<<this<<" allocate "<<n<<" cell(s) at index "<<(int)current<<" for "<<std::hex<<typeid(CELL).name()<<std::dec<<std::endl;
+			return current;
 		}
 		//should only allocate 1 cell at a time, must not be mixed with allocate()!
 		//why can't it be mixed allocate? that could be useful
 		template<typename CELL> typename CELL::INDEX allocate_at(typename CELL::INDEX i,size_t n){
+			enum{SEGREGATED=segregated_fit<typename CELL::PAYLOAD>::value};
+			typename journal<CELL>::transaction t(*this);
 			/*
- 			*	do we have to grow the pool?
+ 			*	do we have to grow the pool? the cells added around the range go on the free list like
+			*	after expand(), segregated pools only grow up to the range
  			*/	 
-			if(buffer_size<(i+n-1)*cell_size){
+			if(buffer_size<(i+n)*cell_size){
 				if((i+n-1)>CELL::max_index){
 					std::cerr<<"CELL::max_index:"<<CELL::max_index<<std::endl;	
 					throw std::bad_alloc();
 				}
-				size_t new_buffer_size=(i+n)*cell_size;
-				LOG_NOTICE<<this<<" increasing pool size from "<<buffer_size<<" to "<<new_buffer_size<<std::endl;
-				typename CELL::RAW_ALLOCATOR raw;
-				auto new_buffer=raw.allocate(new_buffer_size);
-				//the next 3 stages must be avoided when dealing with mmap
-				if(std::is_same<typename CELL::RAW_ALLOCATOR,std::allocator<char>>::value){
-					memcpy(new_buffer,buffer,buffer_size);
-					memset(new_buffer+buffer_size,0,new_buffer_size-buffer_size);
-					raw.deallocate(buffer,buffer_size);	
-				}
-				buffer=new_buffer;
-				buffer_size=new_buffer_size;
+				size_t old_size=buffer_size/cell_size;
+				size_t k=SEGREGATED ? i+n-old_size : std::max<size_t>(growth_policy<typename CELL::PAYLOAD>::get(old_size,i+n-old_size),i+n-old_size);
+				grow<CELL>(std::min<size_t>(old_size+k,CELL::MAX_BUFFER_SIZE)*cell_size);
+				if(!SEGREGATED) release<CELL>(old_size,buffer_size/cell_size-old_size);
 			}
 			CELL *c=(CELL*)buffer;
-			CELL::is_available(c+i,c+i+n);
+			CELL::is_available(c,i,n);
+			if(!SEGREGATED) claim<CELL>(i,n);
+			touch<CELL>(c,0);
+			touch<CELL>(i,n,true);
 			c[0].body.info.size+=n;//update total number of cells in use
-			CELL::post_allocate(c+i,c+i+n);
+			post_allocate<CELL>(c,i,n);
+			get_counters<CELL>().allocated(n);
 			return i;
 		}
+		/*
+		*	take [i,i+n) out of the free ranges holding it (several without OPTIM_POS), the cells on 
+		*	no free range are left as they are
+		*/ 
+		template<typename CELL> void claim(typename CELL::INDEX i,size_t n){
+			CELL *c=(CELL*)buffer;
+			typedef typename CELL::INDEX INDEX;
+			while(n){
+				INDEX prev=0,current=c[prev].body.info.next;
+				while(current && !(current<=i && i<current+c[current].body.info.size)){
+					prev=current;
+					current=c[prev].body.info.next;
+				}
+				size_t m=1;
+				if(current){
+					size_t end=current+c[current].body.info.size;
+					m=std::min<size_t>(n,end-i);
+					size_t before=i-current,after=end-(i+m);
+					INDEX next=c[current].body.info.next;
+					if(after){
+						touch<CELL>(c,i+m);
+						c[i+m].body.info.size=after;
+						c[i+m].body.info.next=next;
+						next=i+m;
+					}
+					if(before){
+						touch<CELL>(c,current);
+						c[current].body.info.size=before;
+						c[current].body.info.next=next;
+					}else{
+						touch<CELL>(c,prev);
+						c[prev].body.info.next=next;
+					}
+					touch<CELL>(c,i);
+					c[i].body.info.size=0;
+					c[i].body.info.next=0;
+				}
+				i+=m;
+				n-=m;
+			}
+		}
 		template<typename CELL> typename CELL::INDEX allocate(size_t n){
 			/*
  			*	how can we make this robust in case of crash?
@@ -1086,26 +3503,34 @@ namespace pool_allocator{
  			*	can we keep a journal with the changes made to the structure?
  			*
  			*/ 
+			if(segregated_fit<typename CELL::PAYLOAD>::value) return allocate_segregated<CELL>(n);
+			typename journal<CELL>::transaction t(*this);
 			display<CELL>();
 			CELL *c=(CELL*)buffer;
 			typedef typename CELL::INDEX INDEX;
 			INDEX prev=0,current=c[prev].body.info.next;
 			//LOG<<"current: "<<(int)current<<endl;
 			//this should be made thread-safe
+			size_t steps=0;
 			while(current && c[current].body.info.size<n){
-				LOG_DEBUG<<"\t"<<(int)current<<std::endl;
+				POOL_LOG_DEBUG<<"\t"<<(int)current<<std::endl;
 				prev=current;
 				current=c[prev].body.info.next;
+				++steps;
 			}
+			counters::add(get_counters<CELL>().free_list_steps,steps);
 			//could we have an atomic variable that tells us if the cell is actually free?
 			if(current){ //we have found enough contiguous cells
 				if(c[current].body.info.size==n){
 					//LOG<<"found!"<<(int)prev<<"\t"<<(int)current<<"\t"<<(int)c[current].body.info.next<<endl;
 					/* 1 WRITE */
+					touch<CELL>(c,prev);
 					c[prev].body.info.next=c[current].body.info.next;
 				}else{	//create new group
 					INDEX i=current+n;
 					/* 3 WRITES */
+					touch<CELL>(c,prev);
+					touch<CELL>(c,i);
 					c[prev].body.info.next=i;
 					c[i].body.info.size=c[current].body.info.size-n;
 					c[i].body.info.next=c[current].body.info.next;
@@ -1113,14 +3538,17 @@ namespace pool_allocator{
 				//shall we clean up this cell???
 				//we could although it is not necessary, an allocator does not have to initialize the memory
 				/* 2 WRITES */
+				touch<CELL>(c,current);
 				c[current].body.info.size=0;
 				c[current].body.info.next=0;
 				/*
 				* update total number of cells in use: if this write fails it will leave pool in inconsistent state
 				*/
 				/* 1 WRITE */	
+				touch<CELL>(c,0);
+				touch<CELL>(current,n,true);
 				c[0].body.info.size+=n;
-				CELL::post_allocate(c+current,c+current+n);
+				post_allocate<CELL>(c,current,n);
 			}else{
 				//let's see how many cells we need to fulfill demand
 				//this is wrong because maybe the buffer is not used but hard to tell if not ordered
@@ -1128,14 +3556,14 @@ namespace pool_allocator{
 				size_t new_size=0;
 				//does not work if prev is 0!!!
 				if(prev && prev+c[prev].body.info.size==buffer_size/cell_size){
-					LOG_DEBUG<<"last cell!"<<std::endl;
+					POOL_LOG_DEBUG<<"last cell!"<<std::endl;
 					new_size=n-c[prev].body.info.size;
 				}else{
 					new_size=n;
 				}
-				LOG_NOTICE<<"new buffer size:"<<(buffer_size/cell_size)+new_size<<" vs "<<(CELL::MAX_BUFFER_SIZE)<<std::endl;
-				if(((buffer_size/cell_size)+new_size)>(CELL::MAX_BUFFER_SIZE)) throw std::bad_alloc();
-				size_t new_buffer_size=buffer_size+new_size*cell_size;
+				size_t old_buffer_size=buffer_size;
+				expand<CELL>(new_size);
+				size_t new_buffer_size=buffer_size;
 				/*
 				#ifdef OPTIM_POS
 				//grow last region	
@@ -1147,30 +3575,21 @@ namespace pool_allocator{
 				#endif
 				size_t new_buffer_size=min<size_t>(max<size_t>(buffer_size+n*cell_size,2*buffer_size),CELL::MAX_SIZE*cell_size);
 				*/
-				LOG_NOTICE<<this<<" increasing pool size from "<<buffer_size<<" to "<<new_buffer_size<<std::endl;
-				//at this stage we may decide to increase the original buffer
-				//we need to create new buffer, copy in the old one
-				typename CELL::RAW_ALLOCATOR raw;
-				auto new_buffer=raw.allocate(new_buffer_size);
-				//the next 3 stages must be avoided when dealing with mmap
-				if(std::is_same<typename CELL::RAW_ALLOCATOR,std::allocator<char>>::value){
-					memcpy(new_buffer,buffer,buffer_size);
-					memset(new_buffer+buffer_size,0,new_buffer_size-buffer_size);
-					raw.deallocate(buffer,buffer_size);	
-				}
-				buffer=new_buffer;
 				CELL *c=(CELL*)buffer;
 				//add the new range
 				#ifdef OPTIM_POS
 				/*
  				*	add after last region
  				*/ 
-				if(buffer_size/cell_size==CELL::MAX_BUFFER_SIZE){//pool is full
+				if(old_buffer_size/cell_size==CELL::MAX_BUFFER_SIZE){//pool is full
+					touch<CELL>(c,0);
 					c[0].body.info.size=CELL::MAX_BUFFER_SIZE-1;
 					c[0].body.info.next=0;
 				}else{
-					current=buffer_size/cell_size;	
-					c[current].body.info.size=(new_buffer_size-buffer_size)/cell_size;
+					current=old_buffer_size/cell_size;	
+					touch<CELL>(c,current);
+					touch<CELL>(c,prev);
+					c[current].body.info.size=(new_buffer_size-old_buffer_size)/cell_size;
 					c[current].body.info.next=0;
 					c[prev].body.info.next=current;	
 					//connect
@@ -1180,41 +3599,71 @@ namespace pool_allocator{
 					}
 				}
 				#else
-				c[buffer_size/cell_size].body.info.size=(new_buffer_size-buffer_size)/cell_size;
-				c[buffer_size/cell_size].body.info.next=c[0].body.info.next;
-				c[0].body.info.next=buffer_size/cell_size;	
+				touch<CELL>(c,old_buffer_size/cell_size);
+				touch<CELL>(c,0);
+				c[old_buffer_size/cell_size].body.info.size=(new_buffer_size-old_buffer_size)/cell_size;
+				c[old_buffer_size/cell_size].body.info.next=c[0].body.info.next;
+				c[0].body.info.next=old_buffer_size/cell_size;	
 				#endif
-				buffer_size=new_buffer_size;
 				return allocate<CELL>(n);
 			}
-			LOG_DEBUG<<this<<" allocate "<<n<<" cell(s) at index "<<(int)current<<" for "<<std::hex<<typeid(CELL).name()<<std::dec<<std::endl;
+			get_counters<CELL>().allocated(n);
+			POOL_LOG_DEBUG<<this<<" allocate "<<n<<" cell(s) at index "<<(int)current<<" for "<<std::hex<<typeid(CELL).name()<<std::dec<<std::endl;
 			return current;
 		}	
+		//walks the whole free list, only with POOL_ALLOCATOR_DEBUG
 		template<typename CELL> void display() const{
+			#ifdef POOL_ALLOCATOR_DEBUG
 			CELL *c=(CELL*)buffer;
 			typedef typename CELL::INDEX INDEX;
 			INDEX prev=0,current=c[prev].body.info.next;
 			while(current){
-				LOG_DEBUG<<(int)current<<"\t"<<(int)c[current].body.info.size<<"\t"<<(int)c[current].body.info.next<<std::endl;
+				POOL_LOG_DEBUG<<(int)current<<"\t"<<(int)c[current].body.info.size<<"\t"<<(int)c[current].body.info.next<<std::endl;
 				prev=current;
 				current=c[prev].body.info.next;
 			}
+			#endif
 		}
 		template<typename CELL> void deallocate(typename CELL::INDEX index,size_t n){
-			LOG_DEBUG<<this<<" deallocate "<<n<<" cell(s) at index "<<(int)index<<std::endl;
+			POOL_LOG_DEBUG<<this<<" deallocate "<<n<<" cell(s) at index "<<(int)index<<std::endl;
+			display<CELL>();
+			get_counters<CELL>().deallocated(n);
+			{
+				typename journal<CELL>::transaction t(*this);
+				release<CELL>(index,n);
+				CELL *c=(CELL*)buffer;
+				touch<CELL>(c,0);
+				c[0].body.info.size-=n;//update total number of cells in use
+			}
+			if(trim_threshold<typename CELL::PAYLOAD>::value!=0) auto_trim<CELL>();
+		}
+		//put the range back on the free list, c[0].body.info.size is not updated
+		template<typename CELL> void release(typename CELL::INDEX index,size_t n){
 			CELL *c=(CELL*)buffer;
 			typedef typename CELL::INDEX INDEX;
-			display<CELL>();
+			if(segregated_fit<typename CELL::PAYLOAD>::value){
+				//no coalescing here, the range goes in its class, see bins::pop()
+				auto& b=get_bins<CELL>();
+				if(!b.ready) b.load(c);
+				b.push(c,index,n);
+				++b.released;
+				touch<CELL>(index,n,false);
+				post_deallocate<CELL>(c,index,n);
+				return;
+			}
 			#ifdef OPTIM_POS
 			/*
  			*	we should insert at right position and connect adjacent regions
  			*/ 
 			INDEX prev=0,current=c[prev].body.info.next;
+			size_t steps=0;
 			while(current && current<index){
-				LOG_DEBUG<<"\t"<<(int)current<<std::endl;
+				POOL_LOG_DEBUG<<"\t"<<(int)current<<std::endl;
 				prev=current;
 				current=c[prev].body.info.next;
+				++steps;
 			}
+			counters::add(get_counters<CELL>().free_list_steps,steps);
 			/*
  			* 4 possibilities:
  			* 	.connected to prev
@@ -1222,7 +3671,9 @@ namespace pool_allocator{
  			* 	.connected to current
  			* 	.connected to both (bingo!)
  			*/
-			LOG_DEBUG<<"deallocate: prev,current {"<<(int)prev<<","<<(int)current<<"}"<<std::endl;
+			POOL_LOG_DEBUG<<"deallocate: prev,current {"<<(int)prev<<","<<(int)current<<"}"<<std::endl;
+			touch<CELL>(c,prev);
+			touch<CELL>(c,index);
 			if(current){
 				if(prev && (prev+c[prev].body.info.size==index)){//connected to prev
 					if(index+n==current){//perfect fit
@@ -1253,24 +3704,146 @@ namespace pool_allocator{
 					c[prev].body.info.next=index;
 				}
 			}
-			c[0].body.info.size-=n;//update total number of cells in use
 			#else
+			touch<CELL>(c,index);
+			touch<CELL>(c,0);
 			c[index].body.info.size=n;
 			c[index].body.info.next=c[0].body.info.next;
 			c[0].body.info.next=index;//the last de-allocated region is always first: not optimal 
-			c[0].body.info.size-=n;//update total number of cells in use
 			#endif
-			CELL::post_deallocate(c+index,c+index+n);
+			touch<CELL>(index,n,false);
+			post_deallocate<CELL>(c,index,n);
+		}
+		/*
+		*	n independent cells in one pass over the free list: ranges are taken from the head
+		*	and the buffer grows at most once, f(index) is called for each cell
+		*/ 
+		template<typename CELL,typename F> void allocate_batch(size_t n,F f){
+			typedef typename CELL::INDEX INDEX;
+			typename journal<CELL>::transaction t(*this);
+			CELL *c=(CELL*)buffer;
+			std::vector<std::pair<INDEX,size_t>> runs;
+			size_t k=0;
+			while(k<n){
+				INDEX current;
+				size_t s,taken;
+				if(segregated_fit<typename CELL::PAYLOAD>::value){
+					auto& b=get_bins<CELL>();
+					if(!b.ready) b.load(c);
+					current=b.pop(c,1);
+					if(!current) break;
+					s=c[current].body.info.size;
+					taken=std::min(s,n-k);
+					if(s>taken) b.push(c,current+taken,s-taken);
+				}else{
+					current=c[0].body.info.next;
+					if(!current) break;
+					s=c[current].body.info.size;
+					taken=std::min(s,n-k);
+					touch<CELL>(c,0);
+					if(s>taken){//the rest stays at the same position
+						INDEX i=current+taken;
+						touch<CELL>(c,i);
+						c[i].body.info.size=s-taken;
+						c[i].body.info.next=c[current].body.info.next;
+						c[0].body.info.next=i;
+					}else{
+						c[0].body.info.next=c[current].body.info.next;
+					}
+				}
+				touch<CELL>(c,current);
+				c[current].body.info.size=0;
+				c[current].body.info.next=0;
+				runs.push_back({current,taken});
+				k+=taken;
+			}
+			if(k<n){
+				size_t old_size=buffer_size/cell_size,added;
+				try{
+					added=expand<CELL>(n-k);
+				}catch(std::bad_alloc&){
+					for(auto& r:runs) release<CELL>(r.first,r.second);
+					throw;
+				}
+				c=(CELL*)buffer;
+				runs.push_back({old_size,n-k});
+				if(added>n-k) release<CELL>(old_size+n-k,added-(n-k));
+			}
+			touch<CELL>(c,0);
+			c[0].body.info.size+=n;
+			for(auto& r:runs){
+				touch<CELL>(r.first,r.second,true);
+				post_allocate<CELL>(c,r.first,r.second);
+				for(size_t i=0;i<r.second;++i) f(r.first+i);
+			}
+			get_counters<CELL>().allocated(n);
+		}
+		//consecutive cells are given back as a single range
+		template<typename CELL,typename IT> void deallocate_batch(IT first,IT last){
+			typedef typename CELL::INDEX INDEX;
+			std::vector<INDEX> v(first,last);
+			if(v.empty()) return;
+			std::sort(v.begin(),v.end());
+			typename journal<CELL>::transaction t(*this);
+			size_t start=0;
+			for(size_t i=1;i<=v.size();++i){
+				if(i==v.size()||v[i]!=v[i-1]+1){
+					release<CELL>(v[start],i-start);
+					start=i;
+				}
+			}
+			CELL *c=(CELL*)buffer;
+			touch<CELL>(c,0);
+			c[0].body.info.size-=v.size();
+			get_counters<CELL>().deallocated(v.size());
 		}
 		template<typename CELL> typename CELL::PAYLOAD& get_payload(typename CELL::INDEX index){
 			//can we make a thread-safe version of this? actually what if we make a copy?
 			//LOG<<this<<" dereference cell at index "<<(int)index<<endl;
+			#ifdef POOL_ALLOCATOR_MULTI_PROCESS
+			/*
+			*	allocated by another process after the last remap: taking the allocator lock catches up 
+			*	(see lock_process()), the buffer must not be replaced while another thread grows or remaps it
+			*/
+			if((size_t)(index+1)*sizeof(CELL)>buffer_size){
+				typename allocator<typename CELL::PAYLOAD,typename CELL::INDEX,typename CELL::ALLOCATOR,typename CELL::RAW_ALLOCATOR,typename CELL::MANAGEMENT>::lock_guard lock;
+			}
+			#endif
 			CELL *c=(CELL*)buffer;
 			//what if buffer gets modified here because of pool increase?
-			CELL::check(c[index],index);//bounds checking
+			CELL::check(c,index);//bounds checking
 			//return (typename CELL::PAYLOAD&)c[index].body.payload;	
 			return c[index].body.payload;	
 		}
+		/*
+		*	address of the buffer cached per type so a dereference is one load and one add, it is refreshed
+		*	by set_base() every time the buffer moves; generation counts the moves, a raw pointer obtained
+		*	before the last one might be dangling
+		*/ 
+		template<typename CELL> struct base{
+			static inline char* buffer=nullptr;
+			static inline size_t generation=0;
+		};
+		//old: the address before the growth or shrinking, a buffer grown in place is not a move
+		template<typename CELL> void set_base(const char* old){
+			char* b=buffer;
+			if(b!=old) ++base<CELL>::generation;
+			base<CELL>::buffer=b;
+		}
+		template<typename CELL> static char* get_base(){
+			char* b=base<CELL>::buffer;
+			if(__builtin_expect(!b,0)){
+				auto p=get_pool<CELL>();
+				p->template set_base<CELL>(p->buffer);
+				b=base<CELL>::buffer;
+			}
+			return b;
+		}
+		template<typename CELL,typename PAYLOAD_CELL> static typename CELL::PAYLOAD& get_payload_fast(typename CELL::INDEX index){
+			PAYLOAD_CELL* c=(PAYLOAD_CELL*)get_base<CELL>();
+			PAYLOAD_CELL::check(c,index);//nothing to do for unmanaged cells
+			return c[index].body.payload;
+		}
 		//if we iterate 
 		//SHOULD ONLY BE USED TO ACCESS management
 		template<typename CELL> CELL& get_cell_cast(typename CELL::INDEX index){
@@ -1297,6 +3870,53 @@ namespace pool_allocator{
 			//CELL::PAYLOAD
 			return p;
 		}
+		/*
+		*	parallel traversal: [1,n) is cut in chunks of whole 64-cell words, one per worker, and each
+		*	worker calls f(i) for the live cells of its chunk, next(i,e) gives the first live cell of [i,e).
+		*	The calling thread takes the first chunk, the first exception thrown by f is re-thrown
+		*/ 
+		template<typename NEXT,typename F> static void parallel_scan(size_t n,NEXT next,F f,size_t n_threads){
+			if(!n_threads) n_threads=std::max<size_t>(std::thread::hardware_concurrency(),1);
+			size_t chunk=std::max<size_t>((n+64*n_threads-1)/(64*n_threads),1)*64;
+			std::vector<std::exception_ptr> errors(n_threads);
+			auto work=[&](size_t k){
+				try{
+					size_t e=std::min(n,(k+1)*chunk);
+					for(size_t i=next(std::max<size_t>(k*chunk,1),e);i<e;i=next(i+1,e)) f(i);
+				}catch(...){
+					errors[k]=std::current_exception();
+				}
+			};
+			std::vector<std::thread> workers;
+			for(size_t k=1;k<n_threads&&k*chunk<n;++k) workers.emplace_back(work,k);
+			work(0);
+			for(auto& t:workers) t.join();
+			POOL_LOG_DEBUG<<"parallel scan of "<<n<<" cell(s) with "<<workers.size()+1<<" worker(s)"<<std::endl;
+			for(auto& e:errors) if(e) std::rethrow_exception(e);
+		}
+		//typed traversal, f(payload) runs concurrently so the pool must not change until it returns
+		template<typename CELL,typename F> void parallel_for_each(F f,size_t n_threads){
+			CELL* c=get_cells<CELL>();
+			size_t n=size();
+			if(occupancy<CELL>::ENABLED){
+				auto& o=get_occupancy<CELL>();
+				if(!o.ready) o.load(c,n);
+				parallel_scan(n,[&o](size_t i,size_t e){return o.next(i,e);},[c,&f](size_t i){f(c[i].body.payload);},n_threads);
+			}else{
+				parallel_scan(n,[c](size_t i,size_t e){
+					while(i<e&&!CELL::in_use(c,i)) ++i;
+					return i;
+				},[c,&f](size_t i){f(c[i].body.payload);},n_threads);
+			}
+		}
+		//generic traversal, same as iterator<CELL>
+		template<typename CELL,typename F> static void parallel_for_each(POOL_PTR pool_ptr,F f,size_t n_threads=0){
+			if(!pool_ptr->iterable) throw std::runtime_error("pool not iterable");
+			parallel_scan(pool_ptr->buffer_size/pool_ptr->cell_size,[pool_ptr](size_t i,size_t e){
+				while(i<e&&!pool_ptr->get_cell_cast<CELL>(i).management) ++i;
+				return i;
+			},[pool_ptr,&f](size_t i){f(pool_ptr->get_payload_cast<CELL>(i));},n_threads);
+		}
 		//iterator, need to add safeguards so that CELL makes sense!
 		//what we need is INDEX and PAYLOAD and MANAGEMENT,
 		template<typename CELL> struct iterator{
@@ -1407,22 +4027,229 @@ namespace pool_allocator{
 		typename MANAGEMENT
 	> 	std::mutex pool::allocator<PAYLOAD,INDEX,ALLOCATOR,RAW_ALLOCATOR,MANAGEMENT>::m;
 	#endif
+	template<typename T,bool HUGE_PAGES,bool POPULATE> struct raw_allocator_traits<pool::anonymous_allocator<T,HUGE_PAGES,POPULATE>>{
+		enum{VOLATILE=true};
+		enum{IN_PLACE=true};
+		static void reserve(size_t){}
+		static std::string file_name(){return std::string();}
+		static size_t file_size(){return 0;}
+		static bool writable(const pool::anonymous_allocator<T,HUGE_PAGES,POPULATE>&){return true;}
+		static bool truncate(size_t n){return pool::anonymous_allocator<T,HUGE_PAGES,POPULATE>::truncate(n);}
+	};
+	template<typename T,typename FILE_NAME> struct raw_allocator_traits<pool::mmap_allocator<T,FILE_NAME>>{
+		#ifdef NO_MMAP
+		//plain heap buffers: a new one on every call
+		enum{VOLATILE=true};
+		enum{IN_PLACE=false};
+		#else
+		enum{VOLATILE=false};
+		enum{IN_PLACE=true};
+		#endif
+		static void reserve(size_t n){pool::mmap_allocator<T,FILE_NAME>::reserve(n);}
+		static std::string file_name(){return pool::mmap_allocator<T,FILE_NAME>::get_file_name();}
+		static size_t file_size(){return pool::mmap_allocator<T,FILE_NAME>::get_file_size();}
+		static bool writable(const pool::mmap_allocator<T,FILE_NAME>& r){return r.writable;}
+		static bool truncate(size_t n){return pool::mmap_allocator<T,FILE_NAME>::truncate(n);}
+	};
 
+	/*
+	*	column of a pool: one T per pointer index, stored in its own contiguous buffer instead of inside 
+	*	the cells, so a scan over that field reads dense memory (structure of arrays)
+	*
+	*		struct weight{};
+	*		typedef pool_allocator::column<ALLOCATOR,float,weight> WEIGHT;
+	*		WEIGHT::get(p)=1.0;
+	*
+	*	the buffer comes from the pool's raw allocator rebound to the column, so it is persistent if
+	*	the pool is; T must be trivially copyable, the column follows the growth of the pool lazily 
+	*	and compaction with remap(). Entries are zero when the column grows and after remap(), the 
+	*	column does not see allocate()/deallocate(): a reused index keeps the value of the freed cell,
+	*	set the entry after allocating
+	*/ 
+	template<
+		typename ALLOCATOR,
+		typename T,
+		typename TAG=T	/* tells apart columns of the same type */
+	> struct column{
+		static_assert(std::is_trivially_copyable<T>::value,"column type must be trivially copyable");
+		typedef typename ALLOCATOR::CELL CELL;
+		typedef typename ALLOCATOR::pointer pointer;
+		typedef typename CELL::INDEX INDEX;
+		typedef typename IfThenElse<
+			std::is_same<typename CELL::RAW_ALLOCATOR,std::allocator<char>>::value,
+			typename CELL::RAW_ALLOCATOR,
+			typename CELL::RAW_ALLOCATOR::template rebind<column>::other
+		>::ResultT RAW_ALLOCATOR;
+		static side_buffer<RAW_ALLOCATOR>& get_impl(){
+			static side_buffer<RAW_ALLOCATOR> i;
+			return i;
+		}
+		//number of entries covered by the pool
+		static size_t size(){return pool::get_pool<CELL>()->size()*CELL::FACTOR;}
+		//make room for at least n entries, returns the base
+		static T* reserve(size_t n){
+			auto& c=get_impl();
+			return (T*)c.reserve(n*sizeof(T),[&c,n](size_t){
+				size_t new_buffer_size=std::max(std::max(n,size())*sizeof(T),raw_allocator_traits<RAW_ALLOCATOR>::file_size()/sizeof(T)*sizeof(T));
+				LOG_NOTICE<<"column "<<typeid(TAG).name()<<" from "<<c.buffer_size.load()<<" to "<<new_buffer_size<<std::endl;
+				return new_buffer_size;
+			});
+		}
+		//dense view of the column, valid until the pool grows
+		static T* data(){return reserve(size());}
+		static T& at(size_t i){return reserve(i+1)[i];}
+		static T& get(pointer p){return at(p.index);}
+		//visit (index,entry) for every allocated cell
+		template<typename F> static void for_each(F f){
+			static_assert(CELL::MANAGED,"only managed pools know their allocated cells");
+			ALLOCATOR::flush_magazines();
+			auto p=pool::get_pool<CELL>();
+			auto c=p->template get_cells<CELL>();
+			T* d=data();
+			size_t n=p->size(),k=c[0].body.info.size;
+			for(size_t i=1;k&&i<n;++i,--k){
+				i=pool::next_allocated<CELL>(c,i,n);
+				f(i,d[i]);
+			}
+		}
+		//follow ALLOCATOR::compact(), entries only move down and the indices past the last one are zeroed
+		static void remap(const std::vector<INDEX>& r){
+			T* d=reserve(r.size());
+			size_t n=1;
+			for(size_t i=1;i<r.size();++i){
+				if(r[i]&&r[i]!=i) d[r[i]]=d[i];
+				if(r[i]) n=std::max<size_t>(n,r[i]+1);
+			}
+			if(r.size()>n) memset((void*)(d+n),0,(r.size()-n)*sizeof(T));
+		}
+		static void checkpoint(bool sync=false){get_impl().checkpoint(sync);}
+	};
+	/*
+	*	pointer stored as a distance from the cell holding it, for payloads pointing to payloads of the
+	*	same pool (graph edges, lists, trees): a 16-bit rel_ptr reaches +/-16383 cells whatever the pool size,
+	*	farther targets go through an entry of a side pool (far reference) holding the full index
+	*
+	*		struct node{
+	*			int v;
+	*			pool_allocator::rel_ptr<ALLOCATOR> next;
+	*		};
+	*		typedef persistent_allocator_managed<node,uint32_t> ALLOCATOR;
+	*
+	*	lowest bit 0: delta*2 (0 is null), 1: far entry*2+1. The distance does not change when the buffer moves,
+	*	a rel_ptr is only valid inside a payload of its pool and must be re-assigned after compact(), copying a
+	*	payload out of the pool (on the stack, by value) throws std::logic_error.
+	*	Near targets are dereferenced without going through the pool and without checking the target is allocated,
+	*	far entries are themselves indexed by DELTA: the side pool can hold max/2 entries (16383 for int16_t),
+	*	assigning one more far target throws std::bad_alloc
+	*/ 
+	template<
+		typename ALLOCATOR,
+		typename DELTA=int16_t
+	> struct rel_ptr{
+		static_assert(std::is_signed<DELTA>::value,"the distance is signed");
+		typedef typename ALLOCATOR::CELL CELL;
+		typedef typename ALLOCATOR::pointer pointer;
+		typedef typename ALLOCATOR::value_type value_type;
+		//the payload is still incomplete here, CELL can only be used in the member functions
+		typedef typename pointer::index_type INDEX;
+		//one per far reference, in a pool with the same persistence
+		struct far_ref{
+			INDEX index;
+			far_ref(INDEX index):index(index){}
+		};
+		typedef typename ALLOCATOR::template rebind<far_ref>::other FAR_ALLOCATOR;
+		DELTA d=0;
+		rel_ptr(){}
+		rel_ptr(std::nullptr_t){}
+		rel_ptr(pointer p){*this=p;}
+		rel_ptr(const rel_ptr& r){*this=r.get();}
+		~rel_ptr(){release();}
+		rel_ptr& operator=(const rel_ptr& r){return *this=r.get();}
+		rel_ptr& operator=(std::nullptr_t){
+			release();
+			d=0;
+			return *this;
+		}
+		rel_ptr& operator=(pointer p){
+			release();
+			if(!p.index){
+				d=0;
+				return *this;
+			}
+			ptrdiff_t delta=(ptrdiff_t)p.index-(ptrdiff_t)self();
+			if(delta&&delta>=std::numeric_limits<DELTA>::min()/2&&delta<=std::numeric_limits<DELTA>::max()/2){
+				d=delta*2;
+			}else{
+				FAR_ALLOCATOR a;
+				auto f=a.allocate(1);
+				if(f.index>std::numeric_limits<DELTA>::max()/2){
+					a.deallocate(f,1);
+					throw std::bad_alloc();
+				}
+				a.construct(f,p.index);
+				d=f.index*2+1;
+			}
+			return *this;
+		}
+		pointer get() const{
+			if(!d) return pointer();
+			if(far()) return pointer(far_pointer()->index,0);
+			return pointer(self()+d/2,0);
+		}
+		operator pointer() const{return get();}
+		typename pointer::target_type* operator->() const{return far() ? get().operator->() : near();}
+		typename pointer::target_type& operator*() const{return far() ? *get() : *near();}
+		explicit operator bool() const{return d;}
+		bool operator==(const rel_ptr& r) const{return get()==r.get();}
+		bool operator!=(const rel_ptr& r) const{return get()!=r.get();}
+		bool far() const{return d&1;}
+		//number of far references in use
+		static size_t far_count(){
+			FAR_ALLOCATOR::flush();
+			return FAR_ALLOCATOR().size();
+		}
+	private:
+		typename FAR_ALLOCATOR::pointer far_pointer() const{return typename FAR_ALLOCATOR::pointer((std::make_unsigned_t<DELTA>)d>>1,0);}
+		//same distance from the start of the payload holding this rel_ptr, nullptr if null
+		typename pointer::target_type* near() const{
+			if(!d) return nullptr;
+			auto p=pool::get_pool<CELL>();
+			const char* b=p->buffer;
+			const char* a=(const char*)this;
+			size_t o=(a-b-p->payload_offset)%p->stride;
+			return (typename pointer::target_type*)(a-o+(ptrdiff_t)(d/2)*(ptrdiff_t)p->stride);
+		}
+		void release(){
+			if(far()){
+				FAR_ALLOCATOR a;
+				a.deallocate(far_pointer(),1);
+			}
+		}
+		//index of the payload holding this rel_ptr
+		size_t self() const{
+			auto p=pool::get_pool<CELL>();
+			const char* b=p->buffer;
+			size_t n=p->buffer_size;
+			const char* a=(const char*)this;
+			if(a<b||a>=b+n) throw std::logic_error("rel_ptr outside a payload of its pool");
+			return (a-b)/(CELL::OPTIMIZATION ? sizeof(value_type) : sizeof(CELL));
+		}
+	};
 }
 template<
 	typename _PAYLOAD_,
-	typename INDEX=uint8_t,
+	typename INDEX=POOL_ALLOCATOR_DEFAULT_INDEX,
 	typename FILE_NAME=pool_allocator::pool::file_name<_PAYLOAD_>
 > using persistent_allocator_managed=pool_allocator::pool::allocator<
 	_PAYLOAD_,
 	INDEX,
 	pool_allocator::pool::POOL_ALLOCATOR,
 	pool_allocator::pool::template mmap_allocator<_PAYLOAD_,FILE_NAME>,
-	bool
+	typename pool_allocator::management_layout<_PAYLOAD_,bool>::type
 >;
 template<
 	typename _PAYLOAD_,
-	typename INDEX=uint8_t,
+	typename INDEX=POOL_ALLOCATOR_DEFAULT_INDEX,
 	typename FILE_NAME=pool_allocator::pool::file_name<_PAYLOAD_>
 > using persistent_allocator_unmanaged=pool_allocator::pool::allocator<
 	_PAYLOAD_,
@@ -1433,18 +4260,18 @@ template<
 >;
 template<
 	typename _PAYLOAD_,
-	typename INDEX=uint8_t
+	typename INDEX=POOL_ALLOCATOR_DEFAULT_INDEX
 > using volatile_allocator_managed=pool_allocator::pool::allocator<
 	_PAYLOAD_,
 	INDEX,
 	pool_allocator::pool::POOL_ALLOCATOR,
 	std::allocator<char>,
-	bool
+	typename pool_allocator::management_layout<_PAYLOAD_,bool>::type
 >;
 #ifdef REF_COUNT
 template<
 	typename _PAYLOAD_,
-	typename INDEX=uint8_t
+	typename INDEX=POOL_ALLOCATOR_DEFAULT_INDEX
 > using volatile_allocator_managed_rc=pool_allocator::pool::allocator<
 	_PAYLOAD_,
 	INDEX,
@@ -1456,7 +4283,7 @@ template<
 #endif
 template<
 	typename _PAYLOAD_,
-	typename INDEX=uint8_t
+	typename INDEX=POOL_ALLOCATOR_DEFAULT_INDEX
 > using volatile_allocator_unmanaged=pool_allocator::pool::allocator<
 	_PAYLOAD_,
 	INDEX,
@@ -1464,6 +4291,31 @@ template<
 	std::allocator<char>,
 	void
 >;
+/*
+ *	volatile pools backed by anonymous memory with transparent huge pages, set POPULATE to pre-fault
+ */ 
+template<
+	typename _PAYLOAD_,
+	typename INDEX=POOL_ALLOCATOR_DEFAULT_INDEX,
+	bool POPULATE=false
+> using huge_page_allocator_managed=pool_allocator::pool::allocator<
+	_PAYLOAD_,
+	INDEX,
+	pool_allocator::pool::POOL_ALLOCATOR,
+	pool_allocator::pool::template anonymous_allocator<_PAYLOAD_,true,POPULATE>,
+	typename pool_allocator::management_layout<_PAYLOAD_,bool>::type
+>;
+template<
+	typename _PAYLOAD_,
+	typename INDEX=POOL_ALLOCATOR_DEFAULT_INDEX,
+	bool POPULATE=false
+> using huge_page_allocator_unmanaged=pool_allocator::pool::allocator<
+	_PAYLOAD_,
+	INDEX,
+	pool_allocator::pool::POOL_ALLOCATOR,
+	pool_allocator::pool::template anonymous_allocator<_PAYLOAD_,true,POPULATE>,
+	void
+>;
 template<
 	typename _PAYLOAD_
 > struct singleton_allocator{
@@ -0,0 +1,40 @@
+/*
+ *	test segregated fit free list
+ *
+ *
+ */
+#include "pool_allocator.h"
+#include <set>
+using namespace std;
+struct node{
+	int a,b;
+};
+template<> struct pool_allocator::segregated_fit<node>{enum{value=true};};
+typedef volatile_allocator_managed<node,uint16_t> ALLOCATOR;
+int main(){
+	ALLOCATOR a;
+	vector<ALLOCATOR::pointer> v;
+	for(int i=0;i<1000;++i) v.push_back(a.allocate(1+i%3));
+	assert(a.size()==1000+999/3*3);
+	set<uint16_t> s;
+	for(auto p:v) assert(s.insert(p.index).second);
+	//punch holes
+	for(size_t i=0;i<v.size();i+=2) a.deallocate(v[i],1+i%3);
+	auto p=a.allocate(2);
+	assert(p.index);
+	a.deallocate(p,2);
+	for(size_t i=0;i<v.size();i+=2) v[i]=a.allocate(1+i%3);
+	assert(a.size()==1000+999/3*3);
+	//free list is still a single chain from cell 0
+	auto c=ALLOCATOR::get_pool()->get_cells<ALLOCATOR::CELL>();
+	size_t free_cells=0;
+	for(auto i=c[0].body.info.next;i;i=c[i].body.info.next) free_cells+=c[i].body.info.size;
+	assert(free_cells+ALLOCATOR::used()+1==ALLOCATOR::get_pool()->size());
+	//freed one by one, the cells are merged back when a large range is requested
+	for(size_t i=0;i<v.size();++i) a.deallocate(v[i],1+i%3);
+	ALLOCATOR::flush();
+	size_t capacity=ALLOCATOR::get_pool()->size();
+	auto q=a.allocate(1500);
+	assert(ALLOCATOR::get_pool()->size()==capacity);
+	a.deallocate(q,1500);
+}
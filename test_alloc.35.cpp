@@ -0,0 +1,35 @@
+/*
+ *	test single cell lock-free path with several threads
+ *
+ *
+ */
+#define POOL_ALLOCATOR_THREAD_SAFE
+#include "pool_allocator.h"
+#include <thread>
+using namespace std;
+typedef volatile_allocator_managed<long,uint16_t> ALLOCATOR;
+int main(){
+	vector<thread> t;
+	for(int k=0;k<4;++k) t.emplace_back([k](){
+		ALLOCATOR a;
+		vector<ALLOCATOR::pointer> v;
+		for(int j=0;j<100;++j){
+			for(int i=0;i<50;++i){
+				v.push_back(a.allocate(1));
+				*v.back()=k;
+			}
+			if(j%10==0) a.deallocate(a.allocate(3),3);//slow path
+			for(auto p:v){
+				assert(*p==k);
+				a.deallocate(p,1);
+			}
+			v.clear();
+		}
+	});
+	for(auto& i:t) i.join();
+	ALLOCATOR a;
+	assert(a.size()==0);
+	ALLOCATOR::flush();
+	assert(a.size()==0);
+	assert(a.begin()==a.end());
+}
@@ -0,0 +1,42 @@
+/*
+ *	test batch allocation
+ *
+ *
+ */
+#include "pool_allocator.h"
+#include <set>
+using namespace std;
+struct point{
+	int x,y;
+	point(int x,int y):x(x),y(y){}
+};
+typedef volatile_allocator_managed<point,uint16_t> ALLOCATOR;
+int main(){
+	ALLOCATOR a;
+	vector<ALLOCATOR::pointer> v;
+	ALLOCATOR::construct_allocate_batch(1000,back_inserter(v),1,2);
+	assert(v.size()==1000);
+	ALLOCATOR::flush();
+	assert(a.size()==1000);
+	set<uint16_t> s;
+	for(auto p:v){
+		assert(p->x==1&&p->y==2);
+		assert(s.insert(p.index).second);
+	}
+	size_t n=0;
+	for(auto i=a.cbegin();i!=a.cend();++i) ++n;
+	assert(n==1000);
+	//every other one
+	vector<ALLOCATOR::pointer> w;
+	for(size_t i=0;i<v.size();i+=2) w.push_back(v[i]);
+	a.deallocate_batch(w.begin(),w.end());
+	ALLOCATOR::flush();
+	assert(a.size()==500);
+	w.clear();
+	a.allocate_batch(600,back_inserter(w));
+	ALLOCATOR::flush();
+	assert(a.size()==1100);
+	a.deallocate_batch(w.begin(),w.end());
+	ALLOCATOR::flush();
+	assert(a.size()==500);
+}
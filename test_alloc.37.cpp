@@ -0,0 +1,50 @@
+/*
+ *	test stable mapping: the buffer of a persistent pool does not move when it grows
+ *	and checkpoints
+ *
+ *
+ */
+#define POOL_ALLOCATOR_STABLE_MMAP
+#include "pool_allocator.h"
+using namespace std;
+struct point{
+	int x,y;
+	point(int x,int y):x(x),y(y){}
+};
+typedef persistent_allocator_managed<point,uint32_t> ALLOCATOR;
+int main(){
+	ALLOCATOR a;
+	auto p=a.allocate(1);
+	a.construct(p,1,2);
+	point* raw=&*p;
+	auto buffer=ALLOCATOR::get_pool()->buffer;
+	vector<ALLOCATOR::pointer> v;
+	for(size_t i=0;i<5000;++i){
+		v.push_back(a.allocate(1));
+		a.construct(v.back(),i,i);
+	}
+	assert(p->x==1&&p->y==2);
+	#ifndef NO_MMAP
+	assert(ALLOCATOR::get_pool()->buffer==buffer);
+	assert(raw==&*p&&raw->x==1&&raw->y==2);
+	//only the pages modified since the last checkpoint are written
+	assert(ALLOCATOR::checkpoint(true)>0);
+	assert(ALLOCATOR::checkpoint(true)==0);
+	p->x=3;
+	ALLOCATOR::mark_dirty(p);
+	assert(ALLOCATOR::checkpoint()==1);
+	//an asynchronous checkpoint does not guarantee the write, the page is still dirty
+	assert(ALLOCATOR::checkpoint(true)==1);
+	assert(ALLOCATOR::checkpoint(true)==0);
+	#ifdef POOL_ALLOCATOR_THREAD_SAFE
+	//the flusher writes the dirty pages synchronously in the background
+	pool_allocator::pool::start_flusher(std::chrono::milliseconds(1));
+	a.construct(a.allocate(1),4,4);
+	this_thread::sleep_for(chrono::milliseconds(200));
+	assert(ALLOCATOR::checkpoint(true)==0);
+	a.construct(a.allocate(1),5,5);
+	pool_allocator::pool::stop_flusher();
+	assert(ALLOCATOR::checkpoint()==0);
+	#endif
+	#endif
+}
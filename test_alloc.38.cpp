@@ -0,0 +1,66 @@
+/*
+ *	test journal recovery: a process dies in the middle of an operation, the next one rolls it back
+ *
+ *
+ */
+#include "pool_allocator.h"
+#include <sys/wait.h>
+using namespace std;
+struct point{
+	int x,y;
+	point(int x,int y):x(x),y(y){}
+};
+struct pixel{
+	int x,y;
+	pixel(int x,int y):x(x),y(y){}
+};
+template<> struct pool_allocator::journal_mode<point>{enum{value=pool_allocator::JOURNAL_PER_OP};};
+template<> struct pool_allocator::journal_mode<pixel>{enum{value=pool_allocator::JOURNAL_GROUP};};
+typedef persistent_allocator_managed<point,uint16_t> ALLOCATOR;
+typedef persistent_allocator_managed<pixel,uint16_t> GROUP_ALLOCATOR;
+typedef ALLOCATOR::CELL CELL;
+int main(){
+	#ifdef NO_MMAP
+	return 0;//nothing survives the process
+	#endif
+	if(fork()==0){
+		ALLOCATOR a;
+		for(int i=0;i<10;++i) a.construct(a.allocate(1),i,i);
+		a.deallocate(a.allocate(20),20);
+		//interrupted operation: the header and the management are modified but never committed
+		auto p=ALLOCATOR::get_pool();
+		CELL* c=p->get_cells<CELL>();
+		typename pool_allocator::pool::journal<CELL>::transaction t(*p);
+		pool_allocator::pool::touch<CELL>(c,0);
+		pool_allocator::pool::touch<CELL>(c,1);
+		pool_allocator::pool::touch<CELL>(3,5,false);
+		c[0].body.info.size=1234;
+		c[0].body.info.next=5678;
+		c[1].body.info.next=42;
+		CELL::post_deallocate(c,3,5);
+		_exit(0);
+	}
+	int status;
+	wait(&status);
+	ALLOCATOR a;
+	assert(a.size()==10);
+	size_t n=0;
+	for(auto i=a.cbegin();i!=a.cend();++i){
+		assert(i->x==i->y);
+		++n;
+	}
+	assert(n==10);
+	a.construct(a.allocate(1),10,10);
+	assert(a.size()==11);
+	//group mode: a synchronous checkpoint ends the group, the operations after it are rolled back
+	if(fork()==0){
+		GROUP_ALLOCATOR g;
+		for(int i=0;i<10;++i) g.construct(g.allocate(1),i,i);
+		GROUP_ALLOCATOR::checkpoint(true);
+		for(int i=0;i<5;++i) g.construct(g.allocate(1),i,i);
+		_exit(0);
+	}
+	wait(&status);
+	GROUP_ALLOCATOR g;
+	assert(g.size()==10);
+}
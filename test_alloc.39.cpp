@@ -0,0 +1,65 @@
+/*
+ *	test several processes sharing a persistent pool, one of them dies holding the lock
+ *
+ *
+ */
+#define POOL_ALLOCATOR_MULTI_PROCESS
+#include "pool_allocator.h"
+#include <sys/wait.h>
+using namespace std;
+struct point{
+	int x,y;
+	point(int x,int y):x(x),y(y){}
+};
+template<> struct pool_allocator::journal_mode<point>{enum{value=pool_allocator::JOURNAL_PER_OP};};
+typedef persistent_allocator_managed<point,uint16_t> ALLOCATOR;
+typedef ALLOCATOR::CELL CELL;
+int main(){
+	#ifdef NO_MMAP
+	return 0;//nothing is shared
+	#endif
+	ALLOCATOR a;
+	a.construct(a.allocate(1),-1,-1);
+	for(int k=0;k<4;++k) if(fork()==0){
+		ALLOCATOR a;
+		for(int i=0;i<300;++i){
+			auto p=a.allocate(1);
+			a.construct(p,k,k);
+			if(i%3==0) a.deallocate(p,1);
+		}
+		_exit(0);
+	}
+	int status;
+	while(wait(&status)>0) assert(WIFEXITED(status)&&WEXITSTATUS(status)==0);
+	assert(a.size()==1+4*200);
+	//mapped by the children only, the first dereference catches up under the lock
+	size_t live=0;
+	for(size_t i=1;i<=1+4*200;++i){
+		try{
+			const point& p=*ALLOCATOR::pointer(i,0);
+			assert(p.x==p.y);
+			++live;
+		}catch(std::out_of_range&){}
+	}
+	assert(live==1+4*200);
+	if(fork()==0){
+		ALLOCATOR::lock_guard l;
+		auto p=ALLOCATOR::get_pool();
+		CELL* c=p->get_cells<CELL>();
+		typename pool_allocator::pool::journal<CELL>::transaction t(*p);
+		pool_allocator::pool::touch<CELL>(c,0);
+		c[0].body.info.size=1234;
+		c[0].body.info.next=5678;
+		_exit(0);
+	}
+	wait(&status);
+	//the lock tells us the owner died, the journal is rolled back
+	a.construct(a.allocate(1),-1,-1);
+	assert(a.size()==2+4*200);
+	size_t n=0;
+	for(auto i=a.cbegin();i!=a.cend();++i){
+		assert(i->x==i->y);
+		++n;
+	}
+	assert(n==2+4*200);
+}
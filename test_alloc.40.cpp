@@ -0,0 +1,52 @@
+/*
+ *	test read-only database: the files are opened O_RDONLY and mapped without copy,
+ *	the payloads can be read but any change throws
+ *
+ *
+ */
+#include "pool_allocator.h"
+#include <sys/wait.h>
+#include <sys/stat.h>
+using namespace std;
+struct point{
+	int x,y;
+	point(int x,int y):x(x),y(y){}
+};
+typedef persistent_allocator_managed<point,uint32_t> ALLOCATOR;
+int run(void (*f)()){
+	pid_t pid=fork();
+	if(pid==0){
+		f();
+		exit(0);
+	}
+	int status;
+	waitpid(pid,&status,0);
+	return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+}
+void write(){
+	ALLOCATOR a;
+	for(int i=0;i<100;++i) a.construct(a.allocate(1),i,2*i);
+}
+void read(){
+	//root ignores the permissions
+	if(getuid()==0 && setuid(65534)==-1) exit(1);
+	ALLOCATOR a;
+	assert(!ALLOCATOR::get_pool()->writable);
+	assert(a.size()==100);
+	int i=0;
+	for(auto j=a.cbegin();j!=a.cend();++j,++i) assert(j->x==i&&j->y==2*i);
+	assert(i==100);
+	try{
+		a.allocate(1);
+		exit(1);
+	}catch(std::runtime_error&){}
+}
+int main(){
+	#ifndef NO_MMAP
+	assert(run(write)==0);
+	chmod("db",0755);
+	chmod(pool_allocator::pool::mmap_allocator<pool_allocator::pool>::get_file_name().c_str(),0644);
+	chmod(pool_allocator::pool::mmap_allocator<point>::get_file_name().c_str(),0444);
+	assert(run(read)==0);
+	#endif
+}
@@ -0,0 +1,31 @@
+/*
+ *	test snapshot: the frozen view does not see the changes made after it was taken
+ *
+ *
+ */
+#include "pool_allocator.h"
+using namespace std;
+struct point{
+	int x,y;
+	point(int x,int y):x(x),y(y){}
+};
+typedef persistent_allocator_managed<point,uint32_t> ALLOCATOR;
+int main(){
+	ALLOCATOR a;
+	vector<ALLOCATOR::pointer> v;
+	for(int i=0;i<1000;++i){
+		v.push_back(a.allocate(1));
+		a.construct(v.back(),i,2*i);
+	}
+	auto s=ALLOCATOR::snapshot();
+	//writers keep going
+	for(int i=0;i<1000;i+=2) a.deallocate(v[i],1);
+	for(int i=1;i<1000;i+=2) v[i]->x=-1;
+	for(int i=0;i<1000;++i) a.construct(a.allocate(1),0,0);
+	assert(a.size()==1500);
+	assert(s.size()==1000);
+	int i=0;
+	for(auto j=s.begin();j!=s.end();++j,++i) assert(j->x==i&&j->y==2*i);
+	assert(i==1000);
+	assert(s[v[1].index].x==1);
+}
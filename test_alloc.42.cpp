@@ -0,0 +1,64 @@
+/*
+ *	test compaction: live cells are moved to the front, pointers are translated with
+ *	the remap table and the buffer shrinks
+ *
+ */
+#include "pool_allocator.h"
+using namespace std;
+struct point{
+	int x,y;
+	point(int x,int y):x(x),y(y){}
+};
+typedef persistent_allocator_managed<point,uint32_t> ALLOCATOR;
+typedef persistent_allocator_unmanaged<char,uint32_t> SMALL;//unmanaged, several payloads per cell
+int main(){
+	{
+		ALLOCATOR a;
+		vector<ALLOCATOR::pointer> v;
+		for(int i=0;i<3000;++i){
+			v.push_back(a.allocate(1));
+			a.construct(v.back(),i,2*i);
+		}
+		auto range=a.allocate(3);
+		for(int i=0;i<3;++i) a.construct(range+i,-i,-i);
+		vector<ALLOCATOR::pointer> kept;
+		for(int i=0;i<3000;++i){
+			if(i%3) a.deallocate(v[i],1);
+			else kept.push_back(v[i]);
+		}
+		size_t before=ALLOCATOR::get_pool()->buffer_size;
+		auto remap=ALLOCATOR::compact();
+		#ifndef POOL_ALLOCATOR_MULTI_PROCESS
+		assert(ALLOCATOR::get_pool()->buffer_size<before);
+		#endif
+		assert(a.size()==1003);
+		for(size_t i=0;i<kept.size();++i){
+			kept[i].index=remap[kept[i].index];
+			assert(kept[i]->x==3*(int)i&&kept[i]->y==6*(int)i);
+		}
+		range.index=remap[range.index];
+		for(int i=0;i<3;++i) assert((range+i)->x==-i);
+		//no gap left
+		auto last=a.cbegin();
+		for(size_t i=1;i<a.size();++i) ++last;
+		assert(last.get_cell_index()==a.size());
+		//still usable
+		for(int i=0;i<2000;++i) a.construct(a.allocate(1),0,0);
+		assert(a.size()==3003);
+		assert(kept[1]->x==3);
+	}
+	{
+		SMALL a;
+		vector<SMALL::pointer> v;
+		for(int i=0;i<100;++i){
+			v.push_back(a.allocate(1));
+			*v.back()='a'+i%26;
+		}
+		for(int i=0;i<100;i+=2) a.deallocate(v[i],1);
+		auto remap=SMALL::compact();
+		for(int i=1;i<100;i+=2){
+			v[i].index=remap[v[i].index];
+			assert(*v[i]=='a'+i%26);
+		}
+	}
+}
@@ -0,0 +1,62 @@
+/*
+ *	test trim: the free range at the end of a pool is given back, explicitly or when
+ *	the free cells pass the threshold
+ *
+ */
+#include "pool_allocator.h"
+#include <sys/stat.h>
+using namespace std;
+struct point{
+	int x,y;
+	point(int x,int y):x(x),y(y){}
+};
+struct reading{
+	double v;
+	reading(double v):v(v){}
+};
+namespace pool_allocator{
+	template<> struct trim_threshold<point>{enum{value=0};};
+	template<> struct trim_threshold<reading>{enum{value=50};};
+}
+typedef persistent_allocator_managed<point,uint32_t> ALLOCATOR;
+typedef volatile_allocator_managed<reading,uint32_t> READINGS;
+size_t file_size(string name){
+	struct stat s;
+	return stat(name.c_str(),&s) ? 0 : s.st_size;
+}
+int main(){
+	#ifndef POOL_ALLOCATOR_MULTI_PROCESS
+	//shared pools are not trimmed
+	{
+		ALLOCATOR a;
+		auto p=a.allocate(1);
+		a.construct(p,1,2);
+		auto spike=a.allocate(10000);
+		size_t peak=ALLOCATOR::get_pool()->buffer_size;
+		a.deallocate(spike,10000);
+		size_t released=ALLOCATOR::trim();
+		assert(released>0);
+		assert(ALLOCATOR::get_pool()->buffer_size==peak-released);
+		#ifndef NO_MMAP
+		assert(file_size(pool_allocator::pool::mmap_allocator<point>::get_file_name())<peak);
+		#endif
+		assert(ALLOCATOR::trim()==0);
+		assert(p->x==1&&p->y==2);
+		//grows again
+		auto q=a.allocate(10000);
+		for(int i=0;i<10000;++i) a.construct(q+i,i,i);
+		assert((q+9999)->x==9999);
+		assert(p->x==1&&p->y==2);
+	}
+	#endif
+	{
+		READINGS a;
+		auto p=a.allocate(1);
+		a.construct(p,1.0);
+		auto spike=a.allocate(10000);
+		size_t peak=READINGS::get_pool()->buffer_size;
+		a.deallocate(spike,10000);
+		assert(READINGS::get_pool()->buffer_size<peak);
+		assert(p->v==1.0);
+	}
+}
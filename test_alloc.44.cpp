@@ -0,0 +1,52 @@
+/*
+ *	test occupancy index: iterators skip the free cells with the side bitmap, it has to follow
+ *	allocations, de-allocations, growth and compaction
+ *
+ */
+#include "pool_allocator.h"
+using namespace std;
+struct point{
+	int x,y;
+	point(int x,int y):x(x),y(y){}
+};
+namespace pool_allocator{
+	template<> struct occupancy_index<point>{enum{value=true};};
+}
+typedef persistent_allocator_managed<point,uint32_t> ALLOCATOR;
+//visit the pool, checks the cells are in order
+size_t count(ALLOCATOR& a){
+	size_t n=0,last=0;
+	for(auto i=a.cbegin();i!=a.cend();++i,++n){
+		assert(i.get_cell_index()>last);
+		last=i.get_cell_index();
+	}
+	return n;
+}
+int main(){
+	ALLOCATOR a;
+	vector<ALLOCATOR::pointer> v;
+	for(int i=0;i<1000;++i){
+		v.push_back(a.allocate(1));
+		a.construct(v.back(),i,i);
+	}
+	assert(count(a)==1000);//bitmap loaded here
+	//sparse
+	for(int i=0;i<1000;++i) if(i%100) a.deallocate(v[i],1);
+	assert(count(a)==10);
+	int k=0;
+	for(auto i=a.cbegin();i!=a.cend();++i,++k) assert(i->x%100==0);
+	assert(k==10);
+	//range across words and growth
+	auto range=a.allocate(5000);
+	for(int i=0;i<5000;++i) a.construct(range+i,-1,-1);
+	assert(count(a)==5010);
+	a.deallocate(range,5000);
+	ALLOCATOR::flush();
+	assert(count(a)==10);
+	//compaction rebuilds the bitmap
+	ALLOCATOR::compact();
+	assert(count(a)==10);
+	a.construct(a.allocate(1),0,0);
+	ALLOCATOR::flush();
+	assert(count(a)==11);
+}
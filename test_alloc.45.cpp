@@ -0,0 +1,50 @@
+/*
+ *	test columns: a field stored outside the cells, indexed like the pool, follows growth 
+ *	and compaction
+ *
+ */
+#include "pool_allocator.h"
+using namespace std;
+struct point{
+	int x,y;
+	point(int x,int y):x(x),y(y){}
+};
+struct weight{};
+typedef persistent_allocator_managed<point,uint32_t> ALLOCATOR;
+typedef pool_allocator::column<ALLOCATOR,float,weight> WEIGHT;
+typedef pool_allocator::column<ALLOCATOR,uint8_t> FLAG;
+int main(){
+	ALLOCATOR a;
+	vector<ALLOCATOR::pointer> v;
+	for(int i=0;i<3000;++i){
+		v.push_back(a.allocate(1));
+		a.construct(v.back(),i,i);
+		WEIGHT::get(v.back())=i;
+	}
+	assert(FLAG::get(v[10])==0);
+	FLAG::get(v[10])=1;
+	//dense scan
+	const float* w=WEIGHT::data();
+	double total=0;
+	for(auto& p:v) total+=w[p.index];
+	assert(total==3000.0*2999/2);
+	for(int i=0;i<3000;++i) if(i%2) a.deallocate(v[i],1);
+	size_t n=0;
+	WEIGHT::for_each([&](size_t i,float& x){
+		assert(ALLOCATOR::pointer(i,0)->x==(int)x);
+		++n;
+	});
+	assert(n==1500);
+	auto r=ALLOCATOR::compact();
+	WEIGHT::remap(r);
+	FLAG::remap(r);
+	for(int i=0;i<3000;i+=2){
+		v[i].index=r[v[i].index];
+		assert(WEIGHT::get(v[i])==v[i]->x);
+	}
+	assert(FLAG::get(v[10])==1);
+	//the indices freed by the compaction do not keep the old entries
+	assert(WEIGHT::at(1501)==0);
+	assert(WEIGHT::at(2999)==0);
+	WEIGHT::checkpoint(true);
+}
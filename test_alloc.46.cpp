@@ -0,0 +1,40 @@
+/*
+ *	test parallel traversal: every allocated payload is visited exactly once, typed and generic
+ *
+ */
+#include "pool_allocator.h"
+#include <atomic>
+using namespace std;
+struct point{
+	int x,y;
+	point(int x,int y):x(x),y(y){}
+};
+typedef persistent_allocator_managed<point,uint32_t> ALLOCATOR;
+int main(){
+	ALLOCATOR a;
+	vector<ALLOCATOR::pointer> v;
+	for(int i=0;i<700;++i){
+		v.push_back(a.allocate(1));
+		a.construct(v.back(),i,1);
+	}
+	for(int i=0;i<700;++i) if(i%7) a.deallocate(v[i],1);
+	long expected=0;
+	for(int i=0;i<700;i+=7) expected+=i;
+	for(size_t n_threads:{0,1,3,16}){
+		atomic<long> sum(0),count(0);
+		ALLOCATOR::parallel_for_each([&](point& p){
+			sum+=p.x;
+			count+=p.y;
+		},n_threads);
+		assert(sum==expected);
+		assert(count==(long)a.size());
+	}
+	atomic<long> sum(0);
+	pool_allocator::pool::parallel_for_each<ALLOCATOR::CELL>(ALLOCATOR::get_pool(),[&](point& p){sum+=p.x;},4);
+	assert(sum==expected);
+	//exceptions reach the caller
+	try{
+		ALLOCATOR::parallel_for_each([](point& p){if(p.x==693) throw std::runtime_error("stop");},4);
+		assert(false);
+	}catch(std::runtime_error&){}
+}
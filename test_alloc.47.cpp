@@ -0,0 +1,62 @@
+/*
+ *	test spans: runs of allocated payloads with random access iterators, contiguous for
+ *	unmanaged pools with several payloads per cell
+ *
+ */
+#include "pool_allocator.h"
+#include <numeric>
+using namespace std;
+struct point{
+	int x,y;
+	point(int x,int y):x(x),y(y){}
+};
+typedef persistent_allocator_managed<point,uint32_t> ALLOCATOR;
+typedef volatile_allocator_unmanaged<int,uint32_t> INTS;//2 int per cell
+int main(){
+	{
+		ALLOCATOR a;
+		vector<ALLOCATOR::pointer> v;
+		for(int i=0;i<300;++i){
+			v.push_back(a.allocate(1));
+			a.construct(v.back(),300-i,0);
+		}
+		for(int i=0;i<300;i+=10) a.deallocate(v[i],1);
+		auto s=ALLOCATOR::spans();
+		size_t n=0;
+		for(auto& r:s){
+			assert(!r.contiguous());
+			assert(&r[0]==ALLOCATOR::pointer(r.index,0).operator->());
+			n+=r.size();
+			sort(r.begin(),r.end(),[](const point& a,const point& b){return a.x<b.x;});
+			assert(is_sorted(r.begin(),r.end(),[](const point& a,const point& b){return a.x<b.x;}));
+			assert(r.end()-r.begin()==(ptrdiff_t)r.size());
+		}
+		assert(n==a.size());
+		#ifndef POOL_ALLOCATOR_MAGAZINE
+		//one hole every 10 cells (magazines hand out cells in another order)
+		assert(s.size()==30);
+		#endif
+	}
+	{
+		INTS a;
+		auto p=a.allocate(1000);
+		for(int i=0;i<1000;++i) *(p+i)=i;
+		auto q=a.allocate(10);
+		for(int i=0;i<10;++i) *(q+i)=1;
+		a.deallocate(q,10);
+		INTS::flush();
+		auto s=INTS::spans();
+		long total=0;
+		size_t n=0;
+		for(auto& r:s){
+			assert(r.contiguous());
+			total+=accumulate(r.data(),r.data()+r.size(),0L);
+			n+=r.size();
+		}
+		//1000 is a multiple of the payloads per cell: no unused slot
+		assert(s.size()==1);
+		assert(n==1000);
+		assert(total==999L*1000/2);
+		assert(s[0].index==p.index);
+	}
+}
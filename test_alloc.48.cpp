@@ -0,0 +1,48 @@
+/*
+ *	test fast dereference: the cached buffer address follows growth and shrinking
+ *
+ *
+ */
+#define POOL_ALLOCATOR_FAST_DEREF
+#include "pool_allocator.h"
+using namespace std;
+struct point{
+	int x,y;
+	point(int x,int y):x(x),y(y){}
+};
+typedef persistent_allocator_managed<point,uint32_t> ALLOCATOR;
+typedef volatile_allocator_unmanaged<int,uint32_t> INTS;
+int main(){
+	{
+		ALLOCATOR a;
+		auto p=a.allocate(1);
+		a.construct(p,1,2);
+		size_t g=ALLOCATOR::generation();
+		const char* b=ALLOCATOR::get_pool()->buffer;
+		auto q=a.allocate(5000);//the buffer might be grown in place
+		for(int i=0;i<5000;++i) a.construct(q+i,i,-i);
+		assert((ALLOCATOR::generation()!=g)==(ALLOCATOR::get_pool()->buffer!=b));
+		assert(p->x==1&&(*p).y==2);
+		assert((q+4999)->x==4999);
+		a.deallocate(q,5000);
+		try{
+			(q+10)->x=0;
+			assert(false);
+		}catch(std::out_of_range&){}
+		ALLOCATOR::trim();
+		assert(p->x==1);
+		ALLOCATOR::const_pointer c=p;
+		assert(c->y==2);
+	}
+	{
+		INTS a;
+		auto p=a.allocate(1);
+		*p=7;
+		size_t g=INTS::generation();
+		const char* b=INTS::get_pool()->buffer;
+		auto q=a.allocate(10000);//copied to a new buffer
+		for(int i=0;i<10000;++i) *(q+i)=i;
+		assert(INTS::get_pool()->buffer!=b&&INTS::generation()>g);
+		assert(*p==7&&*(q+9999)==9999);
+	}
+}
@@ -0,0 +1,33 @@
+/*
+ *	test counters: allocations, de-allocations and growth are counted per pool, 
+ *	debug output is compiled out unless POOL_ALLOCATOR_DEBUG is defined
+ *
+ */
+#include "pool_allocator.h"
+using namespace std;
+struct point{
+	int x,y;
+	point(int x,int y):x(x),y(y){}
+};
+typedef volatile_allocator_managed<point,uint32_t> ALLOCATOR;
+int main(){
+	ALLOCATOR a;
+	auto& c=ALLOCATOR::get_counters();
+	vector<ALLOCATOR::pointer> v;
+	for(int i=0;i<1000;++i) v.push_back(a.allocate(1));
+	auto r=a.allocate(500);
+	assert(c.cells_allocated>=1500);
+	assert(c.allocations>=2);
+	assert(c.growths>0);
+	for(auto p:v) a.deallocate(p,1);
+	a.deallocate(r,500);
+	ALLOCATOR::flush();//the counters see the cells held by the magazines as allocated
+	assert(c.cells_deallocated==c.cells_allocated);
+	assert(a.size()==0);
+	#ifndef POOL_ALLOCATOR_DEBUG
+	//the stream is not even evaluated
+	int k=0;
+	POOL_LOG_DEBUG<<++k<<endl;
+	assert(k==0);
+	#endif
+}
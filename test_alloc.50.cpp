@@ -0,0 +1,53 @@
+/*
+ *	test stats: free list shape, growth and JSON export of a pool and of all the pools
+ *	loaded by the process
+ *
+ */
+#include "pool_allocator.h"
+using namespace std;
+struct point{
+	int x,y;
+	point(int x,int y):x(x),y(y){}
+};
+typedef persistent_allocator_managed<point,uint32_t> ALLOCATOR;
+typedef volatile_allocator_unmanaged<double,uint32_t> VALUES;
+int main(){
+	{
+		ALLOCATOR a;
+		vector<ALLOCATOR::pointer> v;
+		for(int i=0;i<1000;++i) v.push_back(a.allocate(1));
+		//every other cell freed: many one-cell holes
+		for(int i=0;i<1000;i+=2) a.deallocate(v[i],1);
+		ALLOCATOR::flush();
+		auto s=ALLOCATOR::stats();
+		assert(s.live==500);
+		assert(s.capacity+1==ALLOCATOR::get_pool()->size());
+		assert(s.live+s.free_cells==s.capacity);
+		assert(s.free_ranges>=500);
+		assert(s.free_histogram[0]>=499);
+		assert(s.largest_free>1&&s.largest_free<=s.free_cells);//the end of the last growth
+		assert(s.activity.growths>0);
+		#ifndef NO_MMAP
+		assert(s.activity.remaps==s.activity.growths);
+		#endif
+	}
+	{
+		VALUES a;
+		auto p=a.allocate(1000);
+		auto s=VALUES::stats();
+		assert(s.activity.growths>0&&s.activity.bytes_copied>0);
+		a.deallocate(p,1000);
+	}
+	auto v=pool_allocator::pool::stats_all();
+	assert(v.size()==3);//pool of pools, point, double
+	ostringstream os;
+	pool_allocator::pool::stats::to_json(os,v);
+	string json=os.str();
+	assert(json.front()=='['&&json.back()==']');
+	assert(json.find("\"live\":500")!=string::npos);
+	assert(json.find("\"free_histogram\":[")!=string::npos);
+	#ifdef POOL_ALLOCATOR_LATENCY
+	assert(json.find("\"allocate_latency_ns\":[]")==string::npos);
+	#endif
+	cout<<json<<endl;
+}
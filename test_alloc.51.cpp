@@ -0,0 +1,79 @@
+/*
+ *	test index migration: a pool persisted with a uint8_t index is rewritten for uint32_t,
+ *	the cells keep their index and the pool can grow past 255 cells
+ *
+ */
+#define POOL_ALLOCATOR_DEFAULT_INDEX uint16_t
+#include "pool_allocator.h"
+#include <sys/wait.h>
+using namespace std;
+struct point{
+	int x,y;
+	point(int x,int y):x(x),y(y){}
+};
+struct reading{
+	double v;
+	reading(double v):v(v){}
+};
+typedef persistent_allocator_managed<point,uint8_t> SMALL;
+typedef persistent_allocator_managed<point,uint32_t> LARGE;
+typedef persistent_allocator_unmanaged<reading,uint8_t> SMALL_READINGS;
+typedef persistent_allocator_unmanaged<reading,uint32_t> LARGE_READINGS;
+int main(){
+	static_assert(sizeof(volatile_allocator_managed<point>::pointer)==2,"POOL_ALLOCATOR_DEFAULT_INDEX");
+	#ifndef NO_MMAP
+	if(pid_t pid=fork()){
+		int status;
+		waitpid(pid,&status,0);
+		assert(WIFEXITED(status)&&WEXITSTATUS(status)==0);
+	}else{
+		SMALL a;
+		for(int i=0;i<200;++i) a.construct(a.allocate(1),i,-i);
+		for(int i=0;i<200;i+=2) a.deallocate(SMALL::pointer(i+1,0),1);
+		SMALL_READINGS b;
+		auto r=b.allocate(100);
+		for(int i=0;i<100;++i) b.construct(r+i,i*0.5);
+		b.deallocate(r+50,10);
+		SMALL::flush();
+		SMALL_READINGS::flush();
+		exit(0);
+	}
+	assert(LARGE::migrate_from<SMALL>()>200);
+	assert(LARGE_READINGS::migrate_from<SMALL_READINGS>()>100);
+	//the old pool structs are gone
+	assert(pool_allocator::pool::POOL_ALLOCATOR().size()==0);
+	{
+		LARGE a;
+		assert(a.size()==100);
+		//every cell of the file is either live or free
+		auto s=LARGE::stats();
+		assert(s.live+s.free_cells==s.capacity);
+		for(int i=1;i<200;i+=2){
+			auto p=LARGE::pointer(i+1,0);
+			assert(p->x==i&&p->y==-i);
+		}
+		//past the old limit, the holes are reused first
+		vector<LARGE::pointer> v;
+		for(int i=0;i<1000;++i){
+			v.push_back(a.allocate(1));
+			a.construct(v.back(),i,i);
+		}
+		LARGE::flush();
+		assert(a.size()==1100);
+		assert(LARGE::pointer(200,0)->x==199);
+		assert(v.back()->x==999);
+	}
+	{
+		LARGE_READINGS b;
+		auto s=LARGE_READINGS::stats();
+		assert(s.live+s.free_cells==s.capacity);
+		for(int i=0;i<100;++i)
+			if(i<50||i>=60) assert(LARGE_READINGS::pointer(i+1,0)->v==i*0.5);
+		auto r=b.allocate(10);
+		#ifndef SEGREGATED_FIT
+		assert(r.index==51);//the hole
+		#endif
+		b.construct(r,0.0);
+	}
+	#endif
+}
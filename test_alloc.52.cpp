@@ -0,0 +1,64 @@
+/*
+ *	test rel_ptr: 16-bit links in a pool of more than 2^16 cells, near targets are stored as
+ *	a distance, far ones through the side pool
+ *
+ */
+#include "pool_allocator.h"
+using namespace std;
+struct node;
+typedef persistent_allocator_managed<node,uint32_t> ALLOCATOR;
+typedef pool_allocator::rel_ptr<ALLOCATOR> LINK;
+struct node{
+	int v;
+	LINK next,first;
+	node(int v):v(v){}
+};
+int main(){
+	static_assert(sizeof(LINK)==2,"compressed");
+	ALLOCATOR a;
+	const int N=70000;
+	vector<ALLOCATOR::pointer> v;
+	for(int i=0;i<N;++i){
+		v.push_back(a.allocate(1));
+		a.construct(v.back(),i);
+	}
+	for(int i=0;i+1<N;++i) v[i]->next=v[i+1];
+	for(int i=0;i<N;i+=1000) v[i]->first=v[0];//far from i=16384 on, self-reference for 0
+	assert(!v[N-1]->next);
+	assert(v[0]->first->v==0);
+	assert(LINK::far_count()==N/1000-16);
+	//walk the list after the buffer has moved
+	for(int i=0;i<1000;++i) a.construct(a.allocate(1),-1);
+	int k=0;
+	for(ALLOCATOR::pointer p=v[0];p;p=p->next,++k) assert(p->v==k);
+	assert(k==N);
+	for(int i=0;i<N;i+=1000){
+		assert(v[i]->first.get()==v[0]);
+		assert(v[i]->first.far()==(i>16383||i==0));
+	}
+	//copies are re-encoded for their own cell
+	v[N-1]->first=v[20000]->first;
+	assert(v[N-1]->first.far());
+	v[2]->first=v[N-1]->first;
+	assert(!v[2]->first.far()&&v[2]->first->v==0);
+	//far references are given back
+	size_t n=LINK::far_count();
+	v[N-1]->first=nullptr;
+	v[N-2]->next=v[N-3];
+	assert(LINK::far_count()==n-1);
+	assert(v[N-2]->next->v==N-3);
+	//near targets are reached from the address of the link
+	assert(&*v[10]->next==&*v[11]&&v[10]->next.operator->()==v[11].operator->());
+	//copied from a payload of the pool, the links are re-encoded for the new cell
+	auto c=a.allocate(1);
+	a.construct(c,*v[N-5]);
+	assert(c->v==N-5&&c->next->v==N-4&&&*c->next==&*v[N-4]);
+	//only inside the pool
+	bool thrown=false;
+	try{
+		LINK l(v[0]);
+	}catch(std::logic_error&){
+		thrown=true;
+	}
+	assert(thrown);
+}
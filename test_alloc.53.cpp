@@ -0,0 +1,93 @@
+/*
+ *	test the structure of arrays layout: the management is stored apart, the cells are as big as
+ *	the payload, the pool survives the process, iterates and compacts like the default layout
+ *
+ */
+#include "pool_allocator.h"
+#include <sys/wait.h>
+using namespace std;
+struct reading{
+	double v;
+	reading(double v):v(v){}
+};
+struct other{
+	double v;
+	other(double v):v(v){}
+};
+template<> struct pool_allocator::soa<reading>{enum{value=true};};
+typedef persistent_allocator_managed<reading,uint32_t> ALLOCATOR;
+typedef volatile_allocator_managed<reading,uint32_t> VOLATILE_ALLOCATOR;
+int main(){
+	static_assert(ALLOCATOR::CELL::SPLIT,"selected by the payload");
+	static_assert(sizeof(ALLOCATOR::CELL)==sizeof(reading),"no padding");
+	static_assert(!persistent_allocator_managed<other,uint32_t>::CELL::SPLIT,"default layout");
+	static_assert(sizeof(persistent_allocator_managed<other,uint32_t>::CELL)==2*sizeof(other),"padded");
+	//rebinding picks the layout of the new payload
+	static_assert(persistent_allocator_managed<other,uint32_t>::rebind<reading>::other::CELL::SPLIT,"rebind");
+	#ifndef NO_MMAP
+	string name=pool_allocator::raw_allocator_traits<ALLOCATOR::_RAW_ALLOCATOR_>::file_name();
+	assert(name.size()>4&&name.substr(name.size()-4)==".soa");
+	if(pid_t pid=fork()){
+		int status;
+		waitpid(pid,&status,0);
+		assert(WIFEXITED(status)&&WEXITSTATUS(status)==0);
+	}else{
+		ALLOCATOR a;
+		vector<ALLOCATOR::pointer> v;
+		for(int i=0;i<1000;++i){
+			v.push_back(a.allocate(1));
+			a.construct(v.back(),i);
+		}
+		for(int i=1;i<1000;i+=2) a.deallocate(v[i],1);
+		ALLOCATOR::flush();
+		ALLOCATOR::checkpoint(true);
+		exit(0);
+	}
+	{
+		ALLOCATOR a;
+		assert(a.size()==500);
+		double total=0;
+		size_t n=0;
+		for(auto i=a.cbegin();i!=a.cend();++i,++n){
+			assert((int)i->v%2==0);
+			total+=i->v;
+		}
+		assert(n==500&&total==499.0*500);
+		//freed in the other process
+		bool thrown=false;
+		try{
+			ALLOCATOR::pointer(2,0)->v;
+		}catch(std::out_of_range&){
+			thrown=true;
+		}
+		assert(thrown);
+		assert(ALLOCATOR::pointer(1,0)->v==0);
+		auto s=ALLOCATOR::stats();
+		assert(s.live+s.free_cells==s.capacity);
+		auto r=ALLOCATOR::compact();
+		assert(r[999]==500&&r[2]==0);
+		assert(ALLOCATOR::pointer(500,0)->v==998);
+		assert(a.size()==500);
+		//the management moved with the cells
+		n=0;
+		for(auto i=a.cbegin();i!=a.cend();++i,++n) assert(i.get_cell_index()==n+1&&i->v==2*n);
+		for(int i=0;i<100;++i) a.construct(a.allocate(1),-i);
+		assert(a.size()==600);
+	}
+	#endif
+	{
+		VOLATILE_ALLOCATOR a;
+		vector<VOLATILE_ALLOCATOR::pointer> v;
+		for(int i=0;i<3000;++i){
+			v.push_back(a.allocate(1));
+			a.construct(v.back(),i);
+		}
+		for(int i=0;i<3000;i+=3) a.deallocate(v[i],1);
+		VOLATILE_ALLOCATOR::flush();
+		assert(a.size()==2000);
+		size_t n=0;
+		for(auto i=a.cbegin();i!=a.cend();++i,++n) assert((int)i->v%3);
+		assert(n==2000);
+		for(int i=1;i<3000;i+=3) assert(v[i]->v==i);
+	}
+}
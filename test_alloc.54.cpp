@@ -0,0 +1,30 @@
+/*
+ *	test POOL_ALLOCATOR_READ_ONLY: the payloads of persistent pools are only reachable through 
+ *	const references, writing through a ptr does not compile, volatile pools are not concerned.
+ *	Compile-time only
+ *
+ */
+#define POOL_ALLOCATOR_READ_ONLY
+#include "pool_allocator.h"
+using namespace std;
+struct point{
+	int x,y;
+	point(int x,int y):x(x),y(y){}
+};
+typedef persistent_allocator_managed<point,uint32_t> ALLOCATOR;
+typedef volatile_allocator_managed<point,uint32_t> VOLATILE_ALLOCATOR;
+//true if p->x can be assigned
+template<typename P,typename=void> struct assignable:false_type{};
+template<typename P> struct assignable<P,void_t<decltype(declval<P>()->x=0,(*declval<P>()).y=0)>>:true_type{};
+int main(){
+	#ifndef NO_MMAP
+	static_assert(!assignable<ALLOCATOR::pointer>::value,"persistent payloads are read-only");
+	static_assert(is_same<decltype(declval<ALLOCATOR::pointer>().operator->()),const point*>::value,"operator->");
+	static_assert(is_same<decltype(*declval<ALLOCATOR::pointer>()),const point&>::value,"operator*");
+	static_assert(is_constructible<const point*,ALLOCATOR::pointer>::value,"conversion to const pointer");
+	static_assert(!is_constructible<point*,ALLOCATOR::pointer>::value,"no conversion to pointer");
+	#endif
+	static_assert(is_same<decltype(*ALLOCATOR().cbegin()),const point&>::value,"iterator");
+	static_assert(assignable<VOLATILE_ALLOCATOR::pointer>::value,"volatile payloads are writable");
+	//nothing to run: a read-only process needs a database written by another build, see test_alloc.40
+}
@@ -0,0 +1,61 @@
+/*
+ *	test anonymous memory pools: the buffer is huge page aligned, grows with mremap (no copy)
+ *	and keeps its content, with and without pre-faulting
+ *
+ */
+#include "pool_allocator.h"
+using namespace std;
+struct point{
+	int x,y;
+	point(int x,int y):x(x),y(y){}
+};
+struct reading{
+	double v;
+	reading(double v):v(v){}
+};
+//the mapping belongs to the payload type: one per pool
+struct pixel{
+	int x,y;
+	pixel(int x,int y):x(x),y(y){}
+};
+typedef huge_page_allocator_managed<point,uint32_t> ALLOCATOR;
+typedef huge_page_allocator_managed<reading,uint32_t,true> POPULATED;
+typedef huge_page_allocator_unmanaged<pixel,uint32_t> UNMANAGED;
+template<typename A,typename F> void fill(size_t n,F f){
+	A a;
+	vector<typename A::pointer> v;
+	//a few MiB: several growths past the first huge page
+	for(size_t i=0;i<n;++i){
+		v.push_back(a.allocate(1));
+		f(a,v.back(),i);
+	}
+	const char* b=A::get_pool()->buffer;
+	assert((uintptr_t)b%(2*1024*1024)==0);
+	auto s=A::stats();
+	assert(s.activity.growths>0);
+	assert(s.activity.remaps==s.activity.growths);
+	assert(s.activity.bytes_copied==0);
+}
+int main(){
+	const size_t n=400000;
+	fill<ALLOCATOR>(n,[](ALLOCATOR& a,ALLOCATOR::pointer p,size_t i){a.construct(p,i,-i);});
+	{
+		ALLOCATOR a;
+		assert(a.size()==n);
+		size_t i=0;
+		for(auto j=a.cbegin();j!=a.cend();++j,++i) assert(j->x==(int)i&&j->y==-(int)i);
+		assert(i==n);
+	}
+	fill<POPULATED>(n,[](POPULATED& a,POPULATED::pointer p,size_t i){a.construct(p,i*0.5);});
+	{
+		POPULATED a;
+		size_t i=0;
+		for(auto j=a.cbegin();j!=a.cend();++j,++i) assert(j->v==i*0.5);
+		assert(i==n);
+	}
+	fill<UNMANAGED>(n,[](UNMANAGED& a,UNMANAGED::pointer p,size_t i){a.construct(p,i,i);});
+	for(size_t i=1;i<=n;++i){
+		UNMANAGED::pointer p(i,0);
+		assert(p->x==(int)i-1&&p->y==(int)i-1);
+	}
+}
@@ -0,0 +1,52 @@
+/*
+ *	test per-thread magazines: size() is exact without flushing, the cells they hold are given
+ *	back before the pool is iterated and when the threads exit
+ *
+ */
+#define POOL_ALLOCATOR_THREAD_SAFE
+#define POOL_ALLOCATOR_MAGAZINE
+#include "pool_allocator.h"
+#include <thread>
+using namespace std;
+typedef volatile_allocator_managed<long,uint16_t> ALLOCATOR;
+int main(){
+	{
+		//the buffer must not move while the other threads dereference their pointers
+		ALLOCATOR a;
+		a.deallocate(a.allocate(512),512);
+	}
+	vector<thread> t;
+	for(int k=0;k<4;++k) t.emplace_back([k](){
+		ALLOCATOR a;
+		vector<ALLOCATOR::pointer> v;
+		for(int j=0;j<100;++j){
+			for(int i=0;i<50;++i){
+				v.push_back(a.allocate(1));
+				*v.back()=k;
+			}
+			for(auto p:v){
+				assert(*p==k);
+				a.deallocate(p,1);
+			}
+			v.clear();
+		}
+	});
+	for(auto& i:t) i.join();
+	ALLOCATOR a;
+	//drained when the threads exit
+	assert(a.size()==0&&ALLOCATOR::used()==0);
+	vector<ALLOCATOR::pointer> v;
+	for(int i=0;i<10;++i) v.push_back(a.allocate(1));
+	//the magazine took more from the pool than was handed out (no magazine for shared pools)
+	assert(a.size()==10&&(ALLOCATOR::used()>10)==ALLOCATOR::magazine_enabled());
+	for(int i=0;i<5;++i) a.deallocate(v[i],1);
+	assert(a.size()==5);
+	assert(ALLOCATOR::stats().live==ALLOCATOR::used());
+	size_t n=0;
+	for(auto i=a.begin();i!=a.end();++i) ++n;
+	assert(n==5&&ALLOCATOR::used()==5);
+	for(int i=5;i<10;++i) a.deallocate(v[i],1);
+	assert(a.size()==0);
+	ALLOCATOR::flush();
+	assert(ALLOCATOR::used()==0&&a.begin()==a.end());
+}
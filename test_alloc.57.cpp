@@ -0,0 +1,64 @@
+/*
+ *	test growth: reserve() grows the pool only once, allocate_at() puts the cells it grows past
+ *	on the free list
+ *
+ */
+#include "pool_allocator.h"
+#include <set>
+using namespace std;
+struct point{
+	int x,y;
+	point(int x,int y):x(x),y(y){}
+};
+struct item{
+	int v;
+	item(int v):v(v){}
+};
+typedef volatile_allocator_managed<point,uint16_t> ALLOCATOR;
+typedef volatile_allocator_managed<item,uint16_t> ITEMS;
+int main(){
+	{
+		ALLOCATOR a;
+		vector<ALLOCATOR::pointer> w;
+		a.allocate_batch(500,back_inserter(w));
+		a.reserve(5000);
+		auto cells=ALLOCATOR::get_pool()->size();
+		assert(cells>=5501);
+		a.allocate_batch(5000,back_inserter(w));
+		assert(ALLOCATOR::get_pool()->size()==cells);
+		assert(a.size()==5500);
+	}
+	#ifndef SEGREGATED_FIT
+	//segregated pools only grow up to the target
+	{
+		ITEMS a;
+		auto p=a.allocate_at(100,1);
+		a.construct(p,-1);
+		assert(a.size()==1);
+		size_t cells=ITEMS::get_pool()->size();
+		assert(cells>101);
+		auto s=ITEMS::stats();
+		assert(s.live==1&&s.live+s.free_cells==s.capacity);
+		//every other cell is handed out without growing
+		vector<ITEMS::pointer> w;
+		a.allocate_batch(cells-2,back_inserter(w));
+		set<uint16_t> v;
+		for(auto q:w){
+			a.construct(q,0);
+			assert(q.index!=100&&v.insert(q.index).second);
+		}
+		assert(ITEMS::get_pool()->size()==cells);
+		assert(p->v==-1);
+		//in the middle of a free range
+		for(uint16_t i=40;i<60;++i) a.deallocate(ITEMS::pointer(i,0),1);
+		a.construct(a.allocate_at(50,1),-2);
+		s=ITEMS::stats();
+		assert(s.live==cells-20&&s.free_cells==19);
+		w.clear();
+		a.allocate_batch(19,back_inserter(w));
+		for(auto q:w) assert(q.index>=40&&q.index<60&&q.index!=50);
+		assert(ITEMS::pointer(50,0)->v==-2);
+		assert(ITEMS::get_pool()->size()==cells);
+	}
+	#endif
+}